@@ -7,6 +7,44 @@ using std::endl;
 #include <memory>
 #include <string>
 #include <functional>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <array>
+#include <numeric>
+#include <charconv>
+#include <limits>
+
+// Render and event dispatch profiling (-DUI_PROFILING=0 compiles it out)
+#ifndef UI_PROFILING
+    #define UI_PROFILING 1
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
 
 
 // https://refactoring.guru/design-patterns/factory-method
@@ -30,30 +68,800 @@ struct Vec2
 
 // Event struct from the SDL library
 // https://www.libsdl.org
-struct SDL_Event
+//
+// This is a minimal mock (only the mouse events, same names and values as SDL2),
+// so the library is not required to compile this file
+enum SDL_EventType : std::uint32_t
+{
+    SDL_MOUSEMOTION = 0x400,
+    SDL_MOUSEBUTTONDOWN,
+    SDL_MOUSEBUTTONUP,
+    SDL_MOUSEWHEEL
+};
+
+constexpr std::uint8_t SDL_BUTTON_LEFT  = 1;
+constexpr std::uint8_t SDL_BUTTON_RIGHT = 3;
+
+struct SDL_MouseMotionEvent
+{
+    std::uint32_t type;
+    std::uint32_t timestamp;
+    std::int32_t x, y;
+    std::int32_t xrel, yrel;
+};
+
+struct SDL_MouseButtonEvent
+{
+    std::uint32_t type;
+    std::uint32_t timestamp;
+    std::uint8_t button;
+    std::uint8_t clicks;
+    std::int32_t x, y;
+};
+
+struct SDL_MouseWheelEvent
+{
+    std::uint32_t type;
+    std::uint32_t timestamp;
+    std::int32_t x, y;
+};
+
+union SDL_Event
+{
+    std::uint32_t type;
+    SDL_MouseMotionEvent motion;
+    SDL_MouseButtonEvent button;
+    SDL_MouseWheelEvent wheel;
+};
+
+
+// Compact draw command, recorded by the renderer and sorted before submission
+struct DrawCommand
+{
+    // What to draw
+    enum class e_type : std::uint8_t { QUAD, TEXT, IMAGE };
+
+    // Drawing order inside a frame, lower layers are drawn first
+    enum class e_layer : std::uint8_t { CLEAR, BACKGROUND, CONTENT, TEXT };
+
+    // How the pixels are produced
+    enum class e_material : std::uint8_t { SOLID, TEXTURED, GLYPHS };
+
+    // Textures known by the backends (0 = untextured)
+    enum class e_texture : std::uint8_t { NONE, ICONS, FONT };
+
+
+    // widget layer | level | layer | material | texture | type | sequence (see makeSortKey)
+    std::uint64_t sortKey;
+
+    // Destination rectangle
+    Rect<float> rect;
+
+    // RGBA8 (0xRRGGBBAA), multiplied with the texture if any
+    std::uint32_t color;
+
+    // Text runs: range inside the text buffer
+    // Images: icon index inside the texture
+    std::uint32_t offset;
+    std::uint32_t length;
+
+    // Quads: corner radius
+    float radius;
+
+
+    // Highest sequence number (28 bits) and level (12 bits)
+    static constexpr std::uint32_t MAX_SEQUENCE = 0xFFFFFFFu;
+    static constexpr std::uint32_t MAX_LEVEL    = 0xFFFu;
+
+    // Text runs: a glyph is narrower than this, relative to the rectangle height
+    static constexpr float MAX_GLYPH_WIDTH = 0.5f;
+
+
+    // State bits first, so sorting groups the commands sharing the same state,
+    // and the sequence number keeps the drawing order between them
+    // The widget layer (16 at most) comes first: a modal panel covers the text under it
+    // The level is set when the frame is flushed: a command overlapping an earlier one
+    // with another state goes above it, so the state sort can't break the painter's order
+    static constexpr auto makeSortKey(std::uint8_t widgetLayer, e_layer layer, e_material material, e_texture texture,
+                                      e_type type, std::uint32_t sequence) noexcept -> std::uint64_t
+    {
+        return (static_cast<std::uint64_t>(widgetLayer & 0xFu) << 60) |
+               (static_cast<std::uint64_t>(layer)    << 44) |
+               (static_cast<std::uint64_t>(material) << 40) |
+               (static_cast<std::uint64_t>(texture)  << 32) |
+               (static_cast<std::uint64_t>(type)     << 28) |
+               (sequence & MAX_SEQUENCE);
+    }
+
+    auto getWidgetLayer() const noexcept -> std::uint8_t  { return static_cast<std::uint8_t>(sortKey >> 60); }
+    auto getLevel()       const noexcept -> std::uint32_t { return static_cast<std::uint32_t>(sortKey >> 48) & MAX_LEVEL; }
+    auto getLayer()    const noexcept -> e_layer    { return static_cast<e_layer>((sortKey >> 44) & 0xFu); }
+    auto getMaterial() const noexcept -> e_material { return static_cast<e_material>((sortKey >> 40) & 0xFu); }
+    auto getTexture()  const noexcept -> e_texture  { return static_cast<e_texture>((sortKey >> 32) & 0xFFu); }
+    auto getType()     const noexcept -> e_type     { return static_cast<e_type>((sortKey >> 28) & 0xFu); }
+    auto getSequence() const noexcept -> std::uint32_t { return static_cast<std::uint32_t>(sortKey) & MAX_SEQUENCE; }
+
+    // Pipeline state bits (layer, material, texture and type)
+    auto getState() const noexcept -> std::uint32_t { return static_cast<std::uint32_t>(sortKey >> 28) & 0xFFFFFu; }
+
+    // Same level and pipeline state, can be drawn with the same draw call
+    auto sameState(const DrawCommand& other) const noexcept -> bool
+    {
+        return (sortKey >> 28) == (other.sortKey >> 28);
+    }
+
+    // Level and sequence set when the frame is flushed
+    void setOrder(std::uint32_t level, std::uint32_t sequence) noexcept
+    {
+        sortKey = (sortKey & 0xF000FFFFF0000000ull) | (static_cast<std::uint64_t>(level & MAX_LEVEL) << 48) | (sequence & MAX_SEQUENCE);
+    }
+};
+
+// Consecutive commands sharing the same state, submitted as one draw call
+struct DrawBatch
+{
+    DrawCommand::e_type type;
+    DrawCommand::e_layer layer;
+    DrawCommand::e_material material;
+    DrawCommand::e_texture texture;
+
+    // Range inside the command buffer
+    std::uint32_t first;
+    std::uint32_t count;
+};
+
+
+// Graphics API wrapper (OpenGL, Vulkan, SDL_Renderer, etc)
+class IRenderBackend
+{
+    public:
+
+        // dtor
+        virtual ~IRenderBackend() = default;
+
+        // One draw call
+        // commands: the whole (sorted) command buffer
+        // text: characters referenced by the text runs
+        virtual void drawBatch(const DrawBatch& batch, const std::vector<DrawCommand>& commands, std::string_view text) = 0;
+
+        // Every batch of the frame was submitted
+        virtual void endFrame() {}
+};
+
+// Prints the draw calls
+class ConsoleBackend final : public IRenderBackend
+{
+    public:
+
+        void drawBatch(const DrawBatch& batch, const std::vector<DrawCommand>& commands, std::string_view text) override;
+};
+
+
+// Everything needed to draw a frame: sorted commands, their text and the batches
+struct RenderList
 {
-    // This is empty, so the library is not required to compile this file
+    std::vector<DrawCommand> commands;
+    std::string text;
+    std::vector<DrawBatch> batches;
+
+    // Submit every batch, then end the frame
+    void draw(IRenderBackend& backend) const;
+
+    // Empty, the memory is kept
+    void clear() noexcept;
 };
 
 
+// Draws the frames on its own thread while the UI thread records the next one
+// Two lists are swapped at frame boundaries: one frame is drawn while another
+// one waits, so the UI thread only waits if it gets two frames ahead
+class RenderThread
+{
+    public:
+
+        // ctor (the backend is only used by this thread from now on)
+        explicit RenderThread(IRenderBackend& backend);
+
+        // dtor (draws the waiting frame first)
+        ~RenderThread();
+
+        RenderThread(const RenderThread&) = delete;
+        auto operator=(const RenderThread&) -> RenderThread& = delete;
+
+
+        // Hand over a frame, frame gets back an empty list (its memory is reused)
+        void submit(RenderList& frame);
+
+        // Wait until every submitted frame is drawn
+        void waitIdle();
+
+
+    private:
+
+        // Thread loop
+        void run();
+
+
+        IRenderBackend& m_backend;
+
+        // Submitted, and being drawn
+        RenderList m_pending;
+        RenderList m_drawing;
+
+        bool m_hasPending = false;
+        bool m_busy = false;
+        bool m_stop = false;
+
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+
+        std::thread m_thread;
+};
+
 // My GUI rendering class
 // (Separation of Concerns)
 // This requires forward declarations
 class Checkbox;
 class Button;
+class Panel;
+class ListView;
 
-struct RenderUI
+class RenderUI
 {
-    // Render every widget type (Visitor)
-    void render(const Checkbox& widget) const { cout << "- Rendering a Checkbox" << endl; }
-    void render(const Button& widget)   const { cout << "- Rendering a Button"   << endl; }
+    public:
+
+        // ctor (draws on the calling thread)
+        explicit RenderUI(IRenderBackend& backend);
+        // ctor (frames are drawn by the render thread)
+        explicit RenderUI(RenderThread& renderThread);
+
+
+        // Record every widget type (Visitor)
+        void render(const Checkbox& widget);
+        void render(const Button& widget);
+        void render(const Panel& widget);
+        void render(const ListView& widget);
+
+        // Restore the background under a dirty region
+        void clear(const Rect<float>& region);
+
+        // Sort the recorded commands by state, merge them into batches
+        // and submit them to the backend (or the render thread)
+        void flush();
+
+        // Frame being recorded (for profiling)
+        auto getRecordedFrame() const noexcept -> const RenderList&;
+
+        // The next commands are drawn in this order (not in recording order),
+        // so widgets can be recorded in any order (grouped by type)
+        void setDrawOrder(std::uint32_t order) noexcept;
+
+        // The alpha of the next commands is multiplied by this opacity
+        void setOpacity(float opacity) noexcept;
+
+        // The next commands are drawn after every command of the lower widget layers
+        void setWidgetLayer(std::uint8_t layer) noexcept;
+
+
+    private:
+
+        // Record a command
+        void push(DrawCommand::e_type type, DrawCommand::e_layer layer, DrawCommand::e_material material,
+                  DrawCommand::e_texture texture, const Rect<float>& rect, std::uint32_t color,
+                  std::uint32_t offset = 0, std::uint32_t length = 0, float radius = 0.0f);
+
+        void pushQuad(DrawCommand::e_layer layer, const Rect<float>& rect, std::uint32_t color, float radius = 0.0f);
+        // Rounded quad with a border (two quads)
+        void pushFrame(const Rect<float>& rect, std::uint32_t fill, std::uint32_t border, float radius);
+        void pushImage(const Rect<float>& rect, std::uint32_t icon, std::uint32_t color);
+        void pushText(const Rect<float>& rect, std::string_view text, std::uint32_t color);
+
+        // Level of every command (in drawing order), false if there are too many of them
+        auto assignLevels() noexcept -> bool;
+
+
+        // Where batches are submitted (one of them)
+        IRenderBackend* m_backend;
+        RenderThread* m_renderThread;
+
+        // Frame being recorded (flat, reused every frame)
+        RenderList m_frame;
+
+        // Sequence of the next commands (recording order if not set)
+        std::int64_t m_drawOrder = -1;
+
+        // Opacity of the next commands
+        float m_opacity = 1.0f;
+
+        // Widget layer of the next commands
+        std::uint8_t m_widgetLayer = 0;
+
+        // Commands drawn in a screen tile, while the levels are assigned
+        // A few of them per tile: covered ones are dropped, the oldest are merged (state MIXED),
+        // and the grid wraps around, which only costs extra levels
+        struct LevelEntry
+        {
+            Rect<float> rect;
+            std::uint32_t state;
+            std::uint32_t level;
+        };
+
+        struct LevelTile
+        {
+            std::uint32_t count;
+            LevelEntry entries[8];
+        };
+
+        static constexpr std::int64_t LEVEL_GRID = 32;
+        static constexpr float LEVEL_TILE_SIZE = 64.0f;
+
+        std::vector<LevelTile> m_levelTiles;
+
+        // Highest level of each state: a command may go up to it, to join its batch
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> m_stateLevels;
+
 };
 
 // App theme handles skins, fonts, colors, etc
-class AppTheme
+// (defined after the widgets, with the text caches)
+class AppTheme;
+
+
+
+// Point inside rectangle test
+template <typename Type>
+constexpr auto contains(const Rect<Type>& rect, Type x, Type y) noexcept -> bool
 {
-};
+    return x >= rect.x && x < rect.x + rect.w &&
+           y >= rect.y && y < rect.y + rect.h;
+}
+
+// Rectangles overlap test
+template <typename Type>
+constexpr auto intersects(const Rect<Type>& a, const Rect<Type>& b) noexcept -> bool
+{
+    return a.x < b.x + b.w && b.x < a.x + a.w &&
+           a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+// Rectangle inside another one test
+template <typename Type>
+constexpr auto covers(const Rect<Type>& outer, const Rect<Type>& inner) noexcept -> bool
+{
+    return inner.x >= outer.x && inner.x + inner.w <= outer.x + outer.w &&
+           inner.y >= outer.y && inner.y + inner.h <= outer.y + outer.h;
+}
+
+// Smallest rectangle containing both
+template <typename Type>
+constexpr auto merge(const Rect<Type>& a, const Rect<Type>& b) noexcept -> Rect<Type>
+{
+    const auto x = std::min(a.x, b.x);
+    const auto y = std::min(a.y, b.y);
+
+    return { x, y, std::max(a.x + a.w, b.x + b.w) - x, std::max(a.y + a.h, b.y + b.h) - y };
+}
+
+// Area inside both (empty if they don't overlap)
+template <typename Type>
+constexpr auto intersection(const Rect<Type>& a, const Rect<Type>& b) noexcept -> Rect<Type>
+{
+    const auto x = std::max(a.x, b.x);
+    const auto y = std::max(a.y, b.y);
+
+    return { x, y, std::max(std::min(a.x + a.w, b.x + b.w) - x, Type{}), std::max(std::min(a.y + a.h, b.y + b.h) - y, Type{}) };
+}
+
+// Largest part of rect around the point (outside of area) that doesn't overlap area
+template <typename Type>
+constexpr auto excludeArea(const Rect<Type>& rect, const Rect<Type>& area, Type x, Type y) noexcept -> Rect<Type>
+{
+    if (!intersects(rect, area))
+        return rect;
+
+    const auto right  = rect.x + rect.w;
+    const auto bottom = rect.y + rect.h;
+
+    // Side bands of rect around area, keep the biggest one holding the point
+    const Rect<Type> bands[] =
+    {
+        { rect.x, rect.y, area.x - rect.x, rect.h },                   // left
+        { area.x + area.w, rect.y, right - area.x - area.w, rect.h },  // right
+        { rect.x, rect.y, rect.w, area.y - rect.y },                   // top
+        { rect.x, area.y + area.h, rect.w, bottom - area.y - area.h }  // bottom
+    };
+
+    Rect<Type> best{ x, y, Type{}, Type{} };
+
+    for (const auto& band : bands)
+        if (contains(band, x, y) && band.w * band.h > best.w * best.h)
+            best = band;
+
+    return best;
+}
+
+
+// ----------------------------------------------------------------
+// SIMD kernels: test a point or a rectangle against packed rectangles,
+// transform packed rectangles and advance packed tweens
+// 16 (AVX-512), 8 (AVX/AVX2) or 4 (SSE) lanes at a time,
+// plain scalar code on other architectures
+// ----------------------------------------------------------------
+namespace simd
+{
+    // Packed rectangles, one array per component
+    struct RectLanes
+    {
+        const float* x;
+        const float* y;
+        const float* w;
+        const float* h;
+
+        std::size_t count;
+    };
+
+    // Packed rectangles that can be modified
+    struct MutableRectLanes
+    {
+        float* x;
+        float* y;
+        float* w;
+        float* h;
+
+        std::size_t count;
+    };
+
+    // Affine transform of a rectangle, the size can move its own position:
+    // x' = x * sx + w * kx + tx,  w' = w * sw  (same for y and h)
+    // Offset: s = 1, scale around p: s = factor, t = p * (1 - factor),
+    // align right: sx = 0, kx = -1, tx = right edge...
+    struct RectTransform
+    {
+        float sx = 1.0f, kx = 0.0f, tx = 0.0f;
+        float sy = 1.0f, ky = 0.0f, ty = 0.0f;
+        float sw = 1.0f, sh = 1.0f;
+    };
+
+    // Transform one rectangle
+    inline void transformRect(const MutableRectLanes& rects, std::size_t index, const RectTransform& transform) noexcept
+    {
+        const auto w = rects.w[index];
+        const auto h = rects.h[index];
+
+        rects.x[index] = rects.x[index] * transform.sx + w * transform.kx + transform.tx;
+        rects.y[index] = rects.y[index] * transform.sy + h * transform.ky + transform.ty;
+        rects.w[index] = w * transform.sw;
+        rects.h[index] = h * transform.sh;
+    }
+
+    // Packed tweens, one array per component
+    // progress = clamp(elapsed / duration, 0, 1)
+    // eased    = ((a * progress + b) * progress + c) * progress
+    // value    = from + delta * eased (two components)
+    struct TweenLanes
+    {
+        float* elapsed;
+        const float* invDuration;
+        const float* a;
+        const float* b;
+        const float* c;
+        const float* from0;
+        const float* from1;
+        const float* delta0;
+        const float* delta1;
+
+        // Results
+        float* progress;
+        float* value0;
+        float* value1;
+
+        std::size_t count;
+    };
+
+    // Advance one tween by dt seconds
+    inline void advanceTween(const TweenLanes& tweens, std::size_t index, float dt) noexcept
+    {
+        const auto elapsed  = tweens.elapsed[index] + dt;
+        const auto progress = std::min(std::max(elapsed * tweens.invDuration[index], 0.0f), 1.0f);
+        const auto eased    = ((tweens.a[index] * progress + tweens.b[index]) * progress + tweens.c[index]) * progress;
+
+        tweens.elapsed[index]  = elapsed;
+        tweens.progress[index] = progress;
+        tweens.value0[index]   = tweens.from0[index] + tweens.delta0[index] * eased;
+        tweens.value1[index]   = tweens.from1[index] + tweens.delta1[index] * eased;
+    }
+
+
+#if defined(__AVX512F__)
+
+    constexpr std::size_t WIDTH = 16;
+
+    // One bit per rectangle (starting at index) containing the point
+    inline auto containsMask(const RectLanes& rects, std::size_t index, float px, float py) noexcept -> std::uint32_t
+    {
+        const auto x = _mm512_loadu_ps(rects.x + index);
+        const auto y = _mm512_loadu_ps(rects.y + index);
+        const auto vx = _mm512_set1_ps(px);
+        const auto vy = _mm512_set1_ps(py);
+
+        auto mask = _mm512_cmp_ps_mask(vx, x, _CMP_GE_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, vx, _mm512_add_ps(x, _mm512_loadu_ps(rects.w + index)), _CMP_LT_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, vy, y, _CMP_GE_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, vy, _mm512_add_ps(y, _mm512_loadu_ps(rects.h + index)), _CMP_LT_OQ);
+
+        return mask;
+    }
+
+    // One bit per rectangle (starting at index) overlapping rect
+    inline auto overlapMask(const RectLanes& rects, std::size_t index, const Rect<float>& rect) noexcept -> std::uint32_t
+    {
+        const auto x = _mm512_loadu_ps(rects.x + index);
+        const auto y = _mm512_loadu_ps(rects.y + index);
+
+        auto mask = _mm512_cmp_ps_mask(x, _mm512_set1_ps(rect.x + rect.w), _CMP_LT_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, _mm512_set1_ps(rect.x), _mm512_add_ps(x, _mm512_loadu_ps(rects.w + index)), _CMP_LT_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, y, _mm512_set1_ps(rect.y + rect.h), _CMP_LT_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, _mm512_set1_ps(rect.y), _mm512_add_ps(y, _mm512_loadu_ps(rects.h + index)), _CMP_LT_OQ);
+
+        return mask;
+    }
+
+    // Transform the rectangles starting at index
+    inline void transformRectLanes(const MutableRectLanes& rects, std::size_t index, const RectTransform& transform) noexcept
+    {
+        const auto w = _mm512_loadu_ps(rects.w + index);
+        const auto h = _mm512_loadu_ps(rects.h + index);
+
+        _mm512_storeu_ps(rects.x + index, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(rects.x + index), _mm512_set1_ps(transform.sx)),
+                                                                      _mm512_mul_ps(w, _mm512_set1_ps(transform.kx))), _mm512_set1_ps(transform.tx)));
+        _mm512_storeu_ps(rects.y + index, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(rects.y + index), _mm512_set1_ps(transform.sy)),
+                                                                      _mm512_mul_ps(h, _mm512_set1_ps(transform.ky))), _mm512_set1_ps(transform.ty)));
+        _mm512_storeu_ps(rects.w + index, _mm512_mul_ps(w, _mm512_set1_ps(transform.sw)));
+        _mm512_storeu_ps(rects.h + index, _mm512_mul_ps(h, _mm512_set1_ps(transform.sh)));
+    }
+
+    // Advance the tweens starting at index by dt seconds
+    inline void advanceTweenLanes(const TweenLanes& tweens, std::size_t index, float dt) noexcept
+    {
+        const auto elapsed  = _mm512_add_ps(_mm512_loadu_ps(tweens.elapsed + index), _mm512_set1_ps(dt));
+        const auto progress = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(elapsed, _mm512_loadu_ps(tweens.invDuration + index)),
+                                                          _mm512_setzero_ps()), _mm512_set1_ps(1.0f));
+
+        auto eased = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(tweens.a + index), progress), _mm512_loadu_ps(tweens.b + index));
+        eased = _mm512_add_ps(_mm512_mul_ps(eased, progress), _mm512_loadu_ps(tweens.c + index));
+        eased = _mm512_mul_ps(eased, progress);
+
+        _mm512_storeu_ps(tweens.elapsed + index, elapsed);
+        _mm512_storeu_ps(tweens.progress + index, progress);
+        _mm512_storeu_ps(tweens.value0 + index, _mm512_add_ps(_mm512_loadu_ps(tweens.from0 + index),
+                                                              _mm512_mul_ps(_mm512_loadu_ps(tweens.delta0 + index), eased)));
+        _mm512_storeu_ps(tweens.value1 + index, _mm512_add_ps(_mm512_loadu_ps(tweens.from1 + index),
+                                                              _mm512_mul_ps(_mm512_loadu_ps(tweens.delta1 + index), eased)));
+    }
+
+#elif defined(__AVX__)
+
+    constexpr std::size_t WIDTH = 8;
+
+    // One bit per rectangle (starting at index) containing the point
+    inline auto containsMask(const RectLanes& rects, std::size_t index, float px, float py) noexcept -> std::uint32_t
+    {
+        const auto x = _mm256_loadu_ps(rects.x + index);
+        const auto y = _mm256_loadu_ps(rects.y + index);
+        const auto vx = _mm256_set1_ps(px);
+        const auto vy = _mm256_set1_ps(py);
+
+        const auto inX = _mm256_and_ps(_mm256_cmp_ps(vx, x, _CMP_GE_OQ),
+                                       _mm256_cmp_ps(vx, _mm256_add_ps(x, _mm256_loadu_ps(rects.w + index)), _CMP_LT_OQ));
+        const auto inY = _mm256_and_ps(_mm256_cmp_ps(vy, y, _CMP_GE_OQ),
+                                       _mm256_cmp_ps(vy, _mm256_add_ps(y, _mm256_loadu_ps(rects.h + index)), _CMP_LT_OQ));
+
+        return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_and_ps(inX, inY)));
+    }
+
+    // One bit per rectangle (starting at index) overlapping rect
+    inline auto overlapMask(const RectLanes& rects, std::size_t index, const Rect<float>& rect) noexcept -> std::uint32_t
+    {
+        const auto x = _mm256_loadu_ps(rects.x + index);
+        const auto y = _mm256_loadu_ps(rects.y + index);
+
+        const auto inX = _mm256_and_ps(_mm256_cmp_ps(x, _mm256_set1_ps(rect.x + rect.w), _CMP_LT_OQ),
+                                       _mm256_cmp_ps(_mm256_set1_ps(rect.x), _mm256_add_ps(x, _mm256_loadu_ps(rects.w + index)), _CMP_LT_OQ));
+        const auto inY = _mm256_and_ps(_mm256_cmp_ps(y, _mm256_set1_ps(rect.y + rect.h), _CMP_LT_OQ),
+                                       _mm256_cmp_ps(_mm256_set1_ps(rect.y), _mm256_add_ps(y, _mm256_loadu_ps(rects.h + index)), _CMP_LT_OQ));
+
+        return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_and_ps(inX, inY)));
+    }
+
+    // Transform the rectangles starting at index
+    inline void transformRectLanes(const MutableRectLanes& rects, std::size_t index, const RectTransform& transform) noexcept
+    {
+        const auto w = _mm256_loadu_ps(rects.w + index);
+        const auto h = _mm256_loadu_ps(rects.h + index);
+
+        _mm256_storeu_ps(rects.x + index, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(rects.x + index), _mm256_set1_ps(transform.sx)),
+                                                                      _mm256_mul_ps(w, _mm256_set1_ps(transform.kx))), _mm256_set1_ps(transform.tx)));
+        _mm256_storeu_ps(rects.y + index, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(rects.y + index), _mm256_set1_ps(transform.sy)),
+                                                                      _mm256_mul_ps(h, _mm256_set1_ps(transform.ky))), _mm256_set1_ps(transform.ty)));
+        _mm256_storeu_ps(rects.w + index, _mm256_mul_ps(w, _mm256_set1_ps(transform.sw)));
+        _mm256_storeu_ps(rects.h + index, _mm256_mul_ps(h, _mm256_set1_ps(transform.sh)));
+    }
+
+    // Advance the tweens starting at index by dt seconds
+    inline void advanceTweenLanes(const TweenLanes& tweens, std::size_t index, float dt) noexcept
+    {
+        const auto elapsed  = _mm256_add_ps(_mm256_loadu_ps(tweens.elapsed + index), _mm256_set1_ps(dt));
+        const auto progress = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(elapsed, _mm256_loadu_ps(tweens.invDuration + index)),
+                                                          _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+
+        auto eased = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(tweens.a + index), progress), _mm256_loadu_ps(tweens.b + index));
+        eased = _mm256_add_ps(_mm256_mul_ps(eased, progress), _mm256_loadu_ps(tweens.c + index));
+        eased = _mm256_mul_ps(eased, progress);
+
+        _mm256_storeu_ps(tweens.elapsed + index, elapsed);
+        _mm256_storeu_ps(tweens.progress + index, progress);
+        _mm256_storeu_ps(tweens.value0 + index, _mm256_add_ps(_mm256_loadu_ps(tweens.from0 + index),
+                                                              _mm256_mul_ps(_mm256_loadu_ps(tweens.delta0 + index), eased)));
+        _mm256_storeu_ps(tweens.value1 + index, _mm256_add_ps(_mm256_loadu_ps(tweens.from1 + index),
+                                                              _mm256_mul_ps(_mm256_loadu_ps(tweens.delta1 + index), eased)));
+    }
+
+#elif defined(__SSE2__)
+
+    constexpr std::size_t WIDTH = 4;
+
+    // One bit per rectangle (starting at index) containing the point
+    inline auto containsMask(const RectLanes& rects, std::size_t index, float px, float py) noexcept -> std::uint32_t
+    {
+        const auto x = _mm_loadu_ps(rects.x + index);
+        const auto y = _mm_loadu_ps(rects.y + index);
+        const auto vx = _mm_set1_ps(px);
+        const auto vy = _mm_set1_ps(py);
 
+        const auto inX = _mm_and_ps(_mm_cmpge_ps(vx, x), _mm_cmplt_ps(vx, _mm_add_ps(x, _mm_loadu_ps(rects.w + index))));
+        const auto inY = _mm_and_ps(_mm_cmpge_ps(vy, y), _mm_cmplt_ps(vy, _mm_add_ps(y, _mm_loadu_ps(rects.h + index))));
+
+        return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_and_ps(inX, inY)));
+    }
+
+    // One bit per rectangle (starting at index) overlapping rect
+    inline auto overlapMask(const RectLanes& rects, std::size_t index, const Rect<float>& rect) noexcept -> std::uint32_t
+    {
+        const auto x = _mm_loadu_ps(rects.x + index);
+        const auto y = _mm_loadu_ps(rects.y + index);
+
+        const auto inX = _mm_and_ps(_mm_cmplt_ps(x, _mm_set1_ps(rect.x + rect.w)),
+                                    _mm_cmplt_ps(_mm_set1_ps(rect.x), _mm_add_ps(x, _mm_loadu_ps(rects.w + index))));
+        const auto inY = _mm_and_ps(_mm_cmplt_ps(y, _mm_set1_ps(rect.y + rect.h)),
+                                    _mm_cmplt_ps(_mm_set1_ps(rect.y), _mm_add_ps(y, _mm_loadu_ps(rects.h + index))));
+
+        return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_and_ps(inX, inY)));
+    }
+
+    // Transform the rectangles starting at index
+    inline void transformRectLanes(const MutableRectLanes& rects, std::size_t index, const RectTransform& transform) noexcept
+    {
+        const auto w = _mm_loadu_ps(rects.w + index);
+        const auto h = _mm_loadu_ps(rects.h + index);
+
+        _mm_storeu_ps(rects.x + index, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(rects.x + index), _mm_set1_ps(transform.sx)),
+                                                             _mm_mul_ps(w, _mm_set1_ps(transform.kx))), _mm_set1_ps(transform.tx)));
+        _mm_storeu_ps(rects.y + index, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(rects.y + index), _mm_set1_ps(transform.sy)),
+                                                             _mm_mul_ps(h, _mm_set1_ps(transform.ky))), _mm_set1_ps(transform.ty)));
+        _mm_storeu_ps(rects.w + index, _mm_mul_ps(w, _mm_set1_ps(transform.sw)));
+        _mm_storeu_ps(rects.h + index, _mm_mul_ps(h, _mm_set1_ps(transform.sh)));
+    }
+
+    // Advance the tweens starting at index by dt seconds
+    inline void advanceTweenLanes(const TweenLanes& tweens, std::size_t index, float dt) noexcept
+    {
+        const auto elapsed  = _mm_add_ps(_mm_loadu_ps(tweens.elapsed + index), _mm_set1_ps(dt));
+        const auto progress = _mm_min_ps(_mm_max_ps(_mm_mul_ps(elapsed, _mm_loadu_ps(tweens.invDuration + index)),
+                                                    _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+        auto eased = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(tweens.a + index), progress), _mm_loadu_ps(tweens.b + index));
+        eased = _mm_add_ps(_mm_mul_ps(eased, progress), _mm_loadu_ps(tweens.c + index));
+        eased = _mm_mul_ps(eased, progress);
+
+        _mm_storeu_ps(tweens.elapsed + index, elapsed);
+        _mm_storeu_ps(tweens.progress + index, progress);
+        _mm_storeu_ps(tweens.value0 + index, _mm_add_ps(_mm_loadu_ps(tweens.from0 + index),
+                                                        _mm_mul_ps(_mm_loadu_ps(tweens.delta0 + index), eased)));
+        _mm_storeu_ps(tweens.value1 + index, _mm_add_ps(_mm_loadu_ps(tweens.from1 + index),
+                                                        _mm_mul_ps(_mm_loadu_ps(tweens.delta1 + index), eased)));
+    }
+
+#else
+
+    constexpr std::size_t WIDTH = 1;
+
+    inline auto containsMask(const RectLanes& rects, std::size_t index, float px, float py) noexcept -> std::uint32_t
+    {
+        return contains(Rect<float>{ rects.x[index], rects.y[index], rects.w[index], rects.h[index] }, px, py);
+    }
+
+    inline auto overlapMask(const RectLanes& rects, std::size_t index, const Rect<float>& rect) noexcept -> std::uint32_t
+    {
+        return intersects(Rect<float>{ rects.x[index], rects.y[index], rects.w[index], rects.h[index] }, rect);
+    }
+
+    inline void transformRectLanes(const MutableRectLanes& rects, std::size_t index, const RectTransform& transform) noexcept
+    {
+        transformRect(rects, index, transform);
+    }
+
+    inline void advanceTweenLanes(const TweenLanes& tweens, std::size_t index, float dt) noexcept
+    {
+        advanceTween(tweens, index, dt);
+    }
+
+#endif
+
+
+    // Appends the index of every set bit (+ base) to hits
+    inline void appendHits(std::uint32_t mask, std::size_t base, std::vector<std::uint32_t>& hits)
+    {
+        while (mask)
+        {
+            hits.push_back(static_cast<std::uint32_t>(base) + static_cast<std::uint32_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    // Appends to hits the index of every rectangle containing the point
+    inline void pointInRects(const RectLanes& rects, const Vec2& point, std::vector<std::uint32_t>& hits)
+    {
+        std::size_t i = 0;
+
+        for (; i + WIDTH <= rects.count; i += WIDTH)
+            appendHits(containsMask(rects, i, point.x, point.y), i, hits);
+
+        // Remaining rectangles
+        for (; i < rects.count; ++i)
+            if (contains(Rect<float>{ rects.x[i], rects.y[i], rects.w[i], rects.h[i] }, point.x, point.y))
+                hits.push_back(static_cast<std::uint32_t>(i));
+    }
+
+    // Appends to hits the index of every rectangle overlapping rect
+    inline void rectsOverlap(const RectLanes& rects, const Rect<float>& rect, std::vector<std::uint32_t>& hits)
+    {
+        std::size_t i = 0;
+
+        for (; i + WIDTH <= rects.count; i += WIDTH)
+            appendHits(overlapMask(rects, i, rect), i, hits);
+
+        // Remaining rectangles
+        for (; i < rects.count; ++i)
+            if (intersects(Rect<float>{ rects.x[i], rects.y[i], rects.w[i], rects.h[i] }, rect))
+                hits.push_back(static_cast<std::uint32_t>(i));
+    }
+
+    // Transform every rectangle
+    inline void transformRects(const MutableRectLanes& rects, const RectTransform& transform) noexcept
+    {
+        std::size_t i = 0;
+
+        for (; i + WIDTH <= rects.count; i += WIDTH)
+            transformRectLanes(rects, i, transform);
+
+        // Remaining rectangles
+        for (; i < rects.count; ++i)
+            transformRect(rects, i, transform);
+    }
+
+    // Advance every tween by dt seconds
+    inline void advanceTweens(const TweenLanes& tweens, float dt) noexcept
+    {
+        std::size_t i = 0;
+
+        for (; i + WIDTH <= tweens.count; i += WIDTH)
+            advanceTweenLanes(tweens, i, dt);
+
+        // Remaining tweens
+        for (; i < tweens.count; ++i)
+            advanceTween(tweens, i, dt);
+    }
+}
 
 
 // Widget types enumeration
@@ -67,48 +875,283 @@ enum class e_widgetType
     IMAGE_VIEW,
     BUTTON,
     RADIO_BUTTON,
-    RADIO_BUTTON_GROUP
+    RADIO_BUTTON_GROUP,
+    LIST_VIEW,
+
+    COUNT
 };
 
 
-// -----------------
-// Widget base class
-// -----------------
-class IWidget
-{
+class IWidget;
+
 
+// ----------------------------------------------------------------
+// Hot widget data, stored as structure of arrays (one entry per widget)
+// Everything touched every frame (hit-testing, culling, rendering)
+// is packed here, while the widgets objects keep the cold data
+// ----------------------------------------------------------------
+class WidgetStore
+{
     public:
 
-        using t_widgetPtr = std::unique_ptr<IWidget>;
+        // Packed widget flags
+        enum e_flag : std::uint8_t
+        {
+            ACTIVE    = 1 << 0,
+            VISIBLE   = 1 << 1,
+            RESIZABLE = 1 << 2,
+            MOVABLE   = 1 << 3
+        };
 
 
     public:
 
-        // ctor
-        IWidget(e_widgetType type, Rect<float>&& dimension);
+        // Add a new entry, returns its index
+        auto add(IWidget* widget, const Rect<float>& dimension, std::uint8_t flags) -> std::uint32_t;
 
-        // dtor
-        virtual ~IWidget() = default;
+        // Remove an entry, the last one takes its place (arrays stay packed)
+        // Returns the widget that moved to the index (nullptr if none)
+        auto remove(std::uint32_t index) noexcept -> IWidget*;
 
+        // Number of entries
+        auto size() const noexcept -> std::uint32_t;
 
-        // Virtual functions:
-        virtual void onClick(const SDL_Event& event) {};
-        virtual void onDoubleClick(const SDL_Event& event) {};
-        virtual void onRelease(const SDL_Event& event) {};
 
-        virtual void onMouseMotion(const SDL_Event& event) {};
-        virtual void onMouseScroll(const SDL_Event& event) {};
+        // Rectangles
+        auto getRect(std::uint32_t index) const noexcept -> Rect<float>;
+        void setRect(std::uint32_t index, const Rect<float>& rect) noexcept;
 
-        virtual void onMouseOver()  {};
-        virtual void onMouseLeave() {};
+        // Flags
+        auto hasFlag(std::uint32_t index, e_flag flag) const noexcept -> bool;
+        void setFlag(std::uint32_t index, e_flag flag, bool enabled) noexcept;
 
-        // Accept a rendering visitor
-        virtual void accept(const RenderUI& renderer) const = 0;
+        // Opacity (0 = transparent, 1 = opaque)
+        auto getOpacity(std::uint32_t index) const noexcept -> float;
+        void setOpacity(std::uint32_t index, float opacity) noexcept;
 
+        // Owner widget
+        auto getWidget(std::uint32_t index) const noexcept -> IWidget*;
 
-        // Getters:
-        auto getWidgetType() const noexcept -> e_widgetType;
-        auto getDimension() const noexcept -> const Rect<float>&;
+
+    private:
+
+        // Rectangles, one array per component
+        std::vector<float> m_x, m_y, m_w, m_h;
+
+        // e_flag bits
+        std::vector<std::uint8_t> m_flags;
+
+        // Opacity of every widget
+        std::vector<float> m_opacity;
+
+        // Back pointers to the widgets
+        std::vector<IWidget*> m_widgets;
+
+};
+
+
+// cpp
+// Add a new entry, returns its index
+auto WidgetStore::add(IWidget* widget, const Rect<float>& dimension, std::uint8_t flags) -> std::uint32_t
+{
+    m_x.push_back(dimension.x);
+    m_y.push_back(dimension.y);
+    m_w.push_back(dimension.w);
+    m_h.push_back(dimension.h);
+
+    m_flags.push_back(flags);
+    m_opacity.push_back(1.0f);
+    m_widgets.push_back(widget);
+
+    return static_cast<std::uint32_t>(m_widgets.size() - 1);
+}
+
+// Remove an entry, the last one takes its place (arrays stay packed)
+// Returns the widget that moved to the index (nullptr if none)
+auto WidgetStore::remove(std::uint32_t index) noexcept -> IWidget*
+{
+    const auto last = m_widgets.size() - 1;
+
+    m_x[index] = m_x[last];
+    m_y[index] = m_y[last];
+    m_w[index] = m_w[last];
+    m_h[index] = m_h[last];
+
+    m_flags[index]   = m_flags[last];
+    m_opacity[index] = m_opacity[last];
+    m_widgets[index] = m_widgets[last];
+
+    m_x.pop_back();
+    m_y.pop_back();
+    m_w.pop_back();
+    m_h.pop_back();
+
+    m_flags.pop_back();
+    m_opacity.pop_back();
+    m_widgets.pop_back();
+
+    return index < last ? m_widgets[index] : nullptr;
+}
+
+// Number of entries
+auto WidgetStore::size() const noexcept -> std::uint32_t
+{
+    return static_cast<std::uint32_t>(m_widgets.size());
+}
+
+
+// Rectangles
+auto WidgetStore::getRect(std::uint32_t index) const noexcept -> Rect<float>
+{
+    return { m_x[index], m_y[index], m_w[index], m_h[index] };
+}
+
+void WidgetStore::setRect(std::uint32_t index, const Rect<float>& rect) noexcept
+{
+    m_x[index] = rect.x;
+    m_y[index] = rect.y;
+    m_w[index] = rect.w;
+    m_h[index] = rect.h;
+}
+
+
+// Flags
+auto WidgetStore::hasFlag(std::uint32_t index, e_flag flag) const noexcept -> bool
+{
+    return (m_flags[index] & flag) != 0;
+}
+
+void WidgetStore::setFlag(std::uint32_t index, e_flag flag, bool enabled) noexcept
+{
+    if (enabled)
+        m_flags[index] |= flag;
+    else
+        m_flags[index] &= static_cast<std::uint8_t>(~flag);
+}
+
+
+// Opacity (0 = transparent, 1 = opaque)
+auto WidgetStore::getOpacity(std::uint32_t index) const noexcept -> float
+{
+    return m_opacity[index];
+}
+
+void WidgetStore::setOpacity(std::uint32_t index, float opacity) noexcept
+{
+    m_opacity[index] = opacity;
+}
+
+
+// Owner widget
+auto WidgetStore::getWidget(std::uint32_t index) const noexcept -> IWidget*
+{
+    return m_widgets[index];
+}
+
+
+// Generational reference to a widget owned by the UserInterface
+// Once the widget is removed its slot gets a new generation,
+// so old handles are detected instead of pointing to another widget
+struct WidgetHandle
+{
+    static constexpr std::uint32_t INVALID = UINT32_MAX;
+
+    std::uint32_t index      = INVALID;
+    std::uint32_t generation = 0;
+
+    auto isValid() const noexcept -> bool { return index != INVALID; }
+
+    auto operator==(const WidgetHandle& other) const noexcept -> bool
+    {
+        return index == other.index && generation == other.generation;
+    }
+    auto operator!=(const WidgetHandle& other) const noexcept -> bool { return !(*this == other); }
+};
+
+
+// Everything a widget needs at construction time
+// (the UserInterface passes it as the first argument of every widget ctor)
+struct WidgetInit
+{
+    const AppTheme& theme;
+    WidgetStore& store;
+};
+
+
+// Observer notified by the widgets when they change
+// (the UserInterface uses it to keep its spatial index up to date)
+class IWidgetObserver
+{
+    public:
+
+        // dtor
+        virtual ~IWidgetObserver() = default;
+
+        // The widget was moved, oldDimension is where it was before
+        virtual void onWidgetMoved(IWidget& widget, const Rect<float>& oldDimension) = 0;
+
+        // The widget looks different, it must be drawn again
+        virtual void onWidgetChanged(IWidget& widget) = 0;
+
+        // The widget was added to a parent, oldDimension is where it was before
+        virtual void onWidgetReparented(IWidget& widget, const Rect<float>& oldDimension) = 0;
+};
+
+
+// -----------------
+// Widget base class
+// -----------------
+class IWidget
+{
+
+    public:
+
+        // ctor
+        IWidget(e_widgetType type, const WidgetInit& init, Rect<float>&& dimension);
+
+        // dtor (detached from its parent and children)
+        virtual ~IWidget();
+
+
+        // Virtual functions:
+        virtual void onClick(const SDL_Event& event) {};
+        virtual void onDoubleClick(const SDL_Event& event) {};
+        virtual void onRelease(const SDL_Event& event) {};
+
+        virtual void onMouseMotion(const SDL_Event& event) {};
+        // Not handled: goes to the parent
+        virtual void onMouseScroll(const SDL_Event& event);
+
+        virtual void onMouseOver()  {};
+        virtual void onMouseLeave() {};
+
+        // Accept a rendering visitor
+        virtual void accept(RenderUI& renderer) const = 0;
+
+        // Screen area fully covered by this widget pixels (it hides the widgets below)
+        virtual auto getOpaqueArea() const noexcept -> Rect<float> { return {}; }
+        // Screen area this widget draws into (its dimension, unless it draws outside)
+        virtual auto getDrawnArea() const noexcept -> Rect<float> { return getDimension(); }
+
+
+        // Getters:
+        auto getWidgetType() const noexcept -> e_widgetType;
+        // Screen position and size
+        auto getDimension() const noexcept -> Rect<float>;
+        // Position relative to the parent (same as getDimension() without parent)
+        auto getLocalDimension() const noexcept -> Rect<float>;
+
+        // Hierarchy:
+        auto getParent() const noexcept -> IWidget*;
+        auto hasChildren() const noexcept -> bool;
+        auto getChildren() const -> const std::vector<IWidget*>&;
+
+        // Add children (its dimension becomes relative to this widget)
+        void addChildren(IWidget* widget);
+
+        // Deepest visible and active widget under the point, this one if no child is
+        // stable (if given) is reduced to an area around the point where the result stays the same
+        auto pickDescendant(const Vec2& point, Rect<float>* stable = nullptr) -> IWidget*;
 
         // Interaction:
         void setVisibility(bool visible);
@@ -120,354 +1163,7521 @@ class IWidget
         auto canBeResized() const noexcept -> bool;
         auto canBeMoved() const noexcept -> bool;
 
-        // Move to another position
+        // Opacity, 0 to 1 (multiplies the opacity of the children)
+        void setOpacity(float opacity);
+        auto getOpacity() const noexcept -> float;
+
+        // Move to another position (relative to the parent)
         void moveTo(const Vec2& position);
         // Apply movement (offset)
         void moveOffset(const Vec2& offset);
+        // Change width and height
+        void resizeTo(const Vec2& size);
+        // Move and resize at once (position relative to the parent)
+        void setLocalDimension(const Rect<float>& dimension);
+
+        // Who gets notified about changes (children included)
+        void setObserver(IWidgetObserver* observer) noexcept;
+
+        // Handle given by the UserInterface (invalid if another widget owns this one)
+        void setHandle(const WidgetHandle& handle) noexcept;
+        auto getHandle() const noexcept -> WidgetHandle;
+
+
+    protected:
+
+        // Ask to be drawn again
+        void markDirty();
+
+
+        // Widget type
+        e_widgetType m_type;
+
+        // Position, size and other attributes live in the store
+        WidgetStore& m_store;
+        std::uint32_t m_index;
+
+        // Change notifications
+        IWidgetObserver* m_observer;
+
+        // Handle in the UserInterface slot map
+        WidgetHandle m_handle;
+
+        // Parent widget
+        IWidget* m_parent;
+        // Children widgets (drawn after this one, in order)
+        std::vector<IWidget*> m_children;
+
+        // Screen rectangle, computed when asked and cached until it is dirty
+        // A dirty widget has only dirty descendants, so a clean one never looks at its parent
+        mutable Rect<float> m_worldDimension;
+        mutable bool m_worldDirty;
+
+
+    private:
+
+        // The screen rectangle of this widget and its descendants must be computed again
+        void invalidateWorldDimension() noexcept;
+
+};
 
 
-    protected:
+// cpp
+// ctor
+IWidget::IWidget(e_widgetType type, const WidgetInit& init, Rect<float>&& dimension)
+    : m_type(type),
+
+      // Default settings: active and visible, not resizable nor movable
+      m_store(init.store),
+      m_index(init.store.add(this, dimension, WidgetStore::ACTIVE | WidgetStore::VISIBLE)),
+
+      m_observer(nullptr),
+
+      m_parent(nullptr),
+
+      m_worldDimension(),
+      m_worldDirty(true)
+{
+}
+
+// dtor (detached from its parent and children)
+IWidget::~IWidget()
+{
+    if (m_parent)
+    {
+        auto& siblings = m_parent->m_children;
+
+        if (const auto found = std::find(siblings.begin(), siblings.end(), this); found != siblings.end())
+            siblings.erase(found);
+    }
+
+    for (auto* child : m_children)
+    {
+        child->m_parent = nullptr;
+        child->invalidateWorldDimension();
+    }
+
+    // The last store entry fills the hole
+    if (auto* moved = m_store.remove(m_index))
+        moved->m_index = m_index;
+}
+
+
+// Getters:
+auto IWidget::getWidgetType() const noexcept -> e_widgetType
+{
+    return m_type;
+}
+
+// Screen position and size
+auto IWidget::getDimension() const noexcept -> Rect<float>
+{
+    if (!m_worldDirty)
+        return m_worldDimension;
+
+    // Dirty ancestors are refreshed on the way (top-down, they stay clean afterwards)
+    const auto local = m_store.getRect(m_index);
+
+    if (m_parent)
+    {
+        const auto parent = m_parent->getDimension();
+        m_worldDimension  = { parent.x + local.x, parent.y + local.y, local.w, local.h };
+    }
+    else
+        m_worldDimension = local;
+
+    m_worldDirty = false;
+
+    return m_worldDimension;
+}
+
+// Position relative to the parent (same as getDimension() without parent)
+auto IWidget::getLocalDimension() const noexcept -> Rect<float>
+{
+    return m_store.getRect(m_index);
+}
+
+
+// Hierarchy:
+auto IWidget::getParent() const noexcept -> IWidget*
+{
+    return m_parent;
+}
+
+auto IWidget::hasChildren() const noexcept -> bool
+{
+    return !m_children.empty();
+}
+
+auto IWidget::getChildren() const -> const std::vector<IWidget*>&
+{
+    return m_children;
+}
+
+
+// Add children (its dimension becomes relative to this widget)
+void IWidget::addChildren(IWidget* widget)
+{
+    const auto oldDimension = widget->getDimension();
+
+    // Leave the previous parent
+    if (auto* previous = widget->m_parent)
+    {
+        auto& siblings = previous->m_children;
+
+        if (const auto found = std::find(siblings.begin(), siblings.end(), widget); found != siblings.end())
+            siblings.erase(found);
+    }
+
+    widget->m_parent = this;
+    widget->invalidateWorldDimension();
+    m_children.push_back(widget);
+
+    if (widget->m_observer)
+        widget->m_observer->onWidgetReparented(*widget, oldDimension);
+}
+
+
+// Deepest visible and active widget under the point, this one if no child is
+auto IWidget::pickDescendant(const Vec2& point, Rect<float>* stable) -> IWidget*
+{
+    // Last children are on top
+    for (auto child = m_children.rbegin(); child != m_children.rend(); ++child)
+    {
+        auto* widget = *child;
+
+        // Hidden or inactive children hide their whole subtree too
+        if (widget->isVisible() && widget->isActive())
+        {
+            const auto dimension = widget->getDimension();
+
+            if (contains(dimension, point.x, point.y))
+            {
+                if (stable)
+                    *stable = intersection(*stable, dimension);
+
+                return widget->pickDescendant(point, stable);
+            }
+
+            // Above the result: the stable area can't reach it
+            if (stable)
+                *stable = excludeArea(*stable, dimension, point.x, point.y);
+        }
+    }
+
+    return this;
+}
+
+
+// Interaction:
+void IWidget::setVisibility(bool visible)
+{
+    if (isVisible() == visible)
+        return;
+
+    m_store.setFlag(m_index, WidgetStore::VISIBLE, visible);
+    markDirty();
+}
+
+void IWidget::shouldBeResized(bool resizable)
+{
+    m_store.setFlag(m_index, WidgetStore::RESIZABLE, resizable);
+}
+
+void IWidget::shouldBeMoved(bool movable)
+{
+    m_store.setFlag(m_index, WidgetStore::MOVABLE, movable);
+}
+
+auto IWidget::isActive() const noexcept -> bool
+{
+    return m_store.hasFlag(m_index, WidgetStore::ACTIVE);
+}
+
+auto IWidget::isVisible() const noexcept -> bool
+{
+    return m_store.hasFlag(m_index, WidgetStore::VISIBLE);
+}
+
+auto IWidget::canBeResized() const noexcept -> bool
+{
+    return m_store.hasFlag(m_index, WidgetStore::RESIZABLE);
+}
+
+auto IWidget::canBeMoved() const noexcept -> bool
+{
+    return m_store.hasFlag(m_index, WidgetStore::MOVABLE);
+}
+
+
+// Opacity, 0 to 1 (multiplies the opacity of the children)
+void IWidget::setOpacity(float opacity)
+{
+    opacity = std::clamp(opacity, 0.0f, 1.0f);
+
+    if (getOpacity() == opacity)
+        return;
+
+    m_store.setOpacity(m_index, opacity);
+    markDirty();
+}
+
+auto IWidget::getOpacity() const noexcept -> float
+{
+    return m_store.getOpacity(m_index);
+}
+
+
+// Move to another position (relative to the parent)
+void IWidget::moveTo(const Vec2& position)
+{
+    const auto local = getLocalDimension();
+
+    setLocalDimension({ position.x, position.y, local.w, local.h });
+}
+
+// Apply movement (offset)
+void IWidget::moveOffset(const Vec2& offset)
+{
+    const auto local = getLocalDimension();
+
+    moveTo({ local.x + offset.x, local.y + offset.y });
+}
+
+// Change width and height
+void IWidget::resizeTo(const Vec2& size)
+{
+    const auto local = getLocalDimension();
+
+    setLocalDimension({ local.x, local.y, size.x, size.y });
+}
+
+// Move and resize at once (position relative to the parent)
+void IWidget::setLocalDimension(const Rect<float>& dimension)
+{
+    const auto oldDimension = getDimension();
+    const auto local = getLocalDimension();
+
+    m_store.setRect(m_index, dimension);
+
+    // The world position changed: children caches become stale too
+    // (only the size changed: the cache stays valid, the children don't care)
+    if (dimension.x != local.x || dimension.y != local.y)
+        invalidateWorldDimension();
+    else
+    {
+        m_worldDimension.w = dimension.w;
+        m_worldDimension.h = dimension.h;
+    }
+
+    if (m_observer)
+        m_observer->onWidgetMoved(*this, oldDimension);
+}
+
+
+// Handle given by the UserInterface (invalid if another widget owns this one)
+void IWidget::setHandle(const WidgetHandle& handle) noexcept
+{
+    m_handle = handle;
+}
+
+auto IWidget::getHandle() const noexcept -> WidgetHandle
+{
+    return m_handle;
+}
+
+
+// Not handled: goes to the parent
+void IWidget::onMouseScroll(const SDL_Event& event)
+{
+    if (m_parent)
+        m_parent->onMouseScroll(event);
+}
+
+
+// Who gets notified about changes (children included)
+void IWidget::setObserver(IWidgetObserver* observer) noexcept
+{
+    m_observer = observer;
+
+    for (auto* child : m_children)
+        child->setObserver(observer);
+}
+
+// Ask to be drawn again
+void IWidget::markDirty()
+{
+    if (m_observer)
+        m_observer->onWidgetChanged(*this);
+}
+
+
+// The screen rectangle of this widget and its descendants must be computed again
+void IWidget::invalidateWorldDimension() noexcept
+{
+    // Already dirty: so is the whole subtree
+    if (m_worldDirty)
+        return;
+
+    m_worldDirty = true;
+
+    for (auto* child : m_children)
+        child->invalidateWorldDimension();
+}
+
+
+
+// ----------------------------------------------------------------
+// Callable stored inside the object (no heap allocation), move-only
+// Used for widget callbacks: a capture bigger than Capacity fails to compile
+// ----------------------------------------------------------------
+template <typename Signature, std::size_t Capacity = 4 * sizeof(void*)>
+class InplaceFunction;
+
+template <typename Result, typename... Args, std::size_t Capacity>
+class InplaceFunction<Result(Args...), Capacity>
+{
+    public:
+
+        // ctor (empty)
+        InplaceFunction() noexcept = default;
+
+        // ctor from any callable (lambda, functor, function pointer)
+        template <typename Callable,
+                  typename = std::enable_if_t<!std::is_same_v<std::decay_t<Callable>, InplaceFunction>>>
+        InplaceFunction(Callable&& callable);
+
+        // dtor
+        ~InplaceFunction();
+
+        // Move-only
+        InplaceFunction(InplaceFunction&& other) noexcept;
+        auto operator=(InplaceFunction&& other) noexcept -> InplaceFunction&;
+
+        InplaceFunction(const InplaceFunction&) = delete;
+        auto operator=(const InplaceFunction&) -> InplaceFunction& = delete;
+
+
+        // Call it (must not be empty)
+        auto operator()(Args... args) const -> Result;
+
+        // Holds a callable?
+        explicit operator bool() const noexcept;
+
+
+    private:
+
+        // Type erasure: one function to call the stored callable,
+        // another one to move it elsewhere (or just destroy it if destination is nullptr)
+        using t_invoke = Result (*)(void* storage, Args&&... args);
+        using t_manage = void (*)(void* destination, void* source) noexcept;
+
+        // Destroy the stored callable (if any)
+        void reset() noexcept;
+
+
+        alignas(std::max_align_t) mutable std::byte m_storage[Capacity];
+
+        t_invoke m_invoke = nullptr;
+        t_manage m_manage = nullptr;
+
+};
+
+
+// --- Template functions implementation ---
+// ctor from any callable (lambda, functor, function pointer)
+template <typename Result, typename... Args, std::size_t Capacity>
+template <typename Callable, typename>
+InplaceFunction<Result(Args...), Capacity>::InplaceFunction(Callable&& callable)
+{
+    using t_callable = std::decay_t<Callable>;
+
+    static_assert(sizeof(t_callable) <= Capacity, "The callable captures too much: it doesn't fit in the InplaceFunction");
+    static_assert(alignof(t_callable) <= alignof(std::max_align_t), "The callable alignment is not supported");
+    static_assert(std::is_nothrow_move_constructible_v<t_callable>, "The callable must be nothrow move constructible");
+    static_assert(std::is_invocable_r_v<Result, t_callable&, Args...>, "The callable has a different signature");
+
+    new (m_storage) t_callable(std::forward<Callable>(callable));
+
+    m_invoke = [](void* storage, Args&&... args) -> Result
+    {
+        return std::invoke(*std::launder(static_cast<t_callable*>(storage)), std::forward<Args>(args)...);
+    };
+
+    m_manage = [](void* destination, void* source) noexcept
+    {
+        auto* callable = std::launder(static_cast<t_callable*>(source));
+
+        if (destination)
+            new (destination) t_callable(std::move(*callable));
+
+        callable->~t_callable();
+    };
+}
+
+// dtor
+template <typename Result, typename... Args, std::size_t Capacity>
+InplaceFunction<Result(Args...), Capacity>::~InplaceFunction()
+{
+    reset();
+}
+
+// Move-only
+template <typename Result, typename... Args, std::size_t Capacity>
+InplaceFunction<Result(Args...), Capacity>::InplaceFunction(InplaceFunction&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+template <typename Result, typename... Args, std::size_t Capacity>
+auto InplaceFunction<Result(Args...), Capacity>::operator=(InplaceFunction&& other) noexcept -> InplaceFunction&
+{
+    if (this == &other)
+        return *this;
+
+    reset();
+
+    if (other.m_manage)
+    {
+        other.m_manage(m_storage, other.m_storage);
+
+        m_invoke = std::exchange(other.m_invoke, nullptr);
+        m_manage = std::exchange(other.m_manage, nullptr);
+    }
+
+    return *this;
+}
+
+// Call it (must not be empty)
+template <typename Result, typename... Args, std::size_t Capacity>
+auto InplaceFunction<Result(Args...), Capacity>::operator()(Args... args) const -> Result
+{
+    return m_invoke(m_storage, std::forward<Args>(args)...);
+}
+
+// Holds a callable?
+template <typename Result, typename... Args, std::size_t Capacity>
+InplaceFunction<Result(Args...), Capacity>::operator bool() const noexcept
+{
+    return m_invoke != nullptr;
+}
+
+// Destroy the stored callable (if any)
+template <typename Result, typename... Args, std::size_t Capacity>
+void InplaceFunction<Result(Args...), Capacity>::reset() noexcept
+{
+    if (m_manage)
+        m_manage(nullptr, m_storage);
+
+    m_invoke = nullptr;
+    m_manage = nullptr;
+}
+
+
+
+// ----------------------------------------------------------------
+// Lock-free queue: many producer threads, one consumer thread
+// push() never blocks (one atomic exchange), pop() only runs on the owner thread
+// Nodes come from a preallocated pool (lock-free free list), the heap is
+// only used when more than PoolSize values are waiting
+// ----------------------------------------------------------------
+template <typename T, std::size_t PoolSize = 256>
+class MpscQueue
+{
+    public:
+
+        // ctor
+        MpscQueue();
+
+        // dtor (drops the values not popped yet)
+        ~MpscQueue();
+
+        MpscQueue(const MpscQueue&) = delete;
+        auto operator=(const MpscQueue&) -> MpscQueue& = delete;
+
+
+        // Any thread
+        void push(T&& value);
+
+        // Consumer thread only, false if empty
+        // (a value being pushed right now may show up on the next call)
+        auto pop(T& value) -> bool;
+
+
+    private:
+
+        struct Node
+        {
+            std::atomic<Node*> next{ nullptr };
+            T value{};
+
+            // Next node of the free list (pool index)
+            std::atomic<std::uint32_t> nextFree{ NONE };
+        };
+
+        static constexpr std::uint32_t NONE = ~std::uint32_t{ 0 };
+
+
+        // Pool node or heap node
+        auto allocate() -> Node*;
+        void release(Node* node) noexcept;
+
+
+        // Preallocated nodes
+        std::unique_ptr<Node[]> m_pool;
+
+        // Free list head: pool index (low 32 bits) | tag (high 32 bits, against ABA)
+        std::atomic<std::uint64_t> m_free;
+
+        // Last pushed node (producers)
+        std::atomic<Node*> m_head;
+
+        // Node before the next value to pop (consumer)
+        Node* m_tail;
+
+};
+
+
+// --- Template functions implementation ---
+// ctor
+template <typename T, std::size_t PoolSize>
+MpscQueue<T, PoolSize>::MpscQueue()
+    : m_pool(std::make_unique<Node[]>(PoolSize)),
+      m_free(NONE)
+{
+    static_assert(PoolSize > 0 && PoolSize < NONE, "Invalid pool size");
+
+    // Every pool node is free
+    for (std::uint32_t i = 0; i < PoolSize; ++i)
+        m_pool[i].nextFree.store(i + 1 < PoolSize ? i + 1 : NONE, std::memory_order_relaxed);
+
+    m_free.store(0, std::memory_order_relaxed);
+
+    // Empty queue: one node without value
+    auto* stub = allocate();
+
+    m_head.store(stub, std::memory_order_relaxed);
+    m_tail = stub;
+}
+
+// dtor (drops the values not popped yet)
+template <typename T, std::size_t PoolSize>
+MpscQueue<T, PoolSize>::~MpscQueue()
+{
+    while (m_tail)
+        release(std::exchange(m_tail, m_tail->next.load(std::memory_order_acquire)));
+}
+
+// Any thread
+template <typename T, std::size_t PoolSize>
+void MpscQueue<T, PoolSize>::push(T&& value)
+{
+    auto* node = allocate();
+    node->value = std::move(value);
+
+    // Link the previous head to the new node
+    auto* previous = m_head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+}
+
+// Consumer thread only, false if empty
+template <typename T, std::size_t PoolSize>
+auto MpscQueue<T, PoolSize>::pop(T& value) -> bool
+{
+    auto* next = m_tail->next.load(std::memory_order_acquire);
+
+    if (!next)
+        return false;
+
+    // The popped node becomes the new empty node
+    value = std::move(next->value);
+    release(std::exchange(m_tail, next));
+
+    return true;
+}
+
+// Pool node or heap node
+template <typename T, std::size_t PoolSize>
+auto MpscQueue<T, PoolSize>::allocate() -> Node*
+{
+    auto head = m_free.load(std::memory_order_acquire);
+
+    while (static_cast<std::uint32_t>(head) != NONE)
+    {
+        auto* node = &m_pool[static_cast<std::uint32_t>(head)];
+        const auto next = node->nextFree.load(std::memory_order_relaxed);
+        const auto tag  = (head >> 32) + 1;
+
+        if (m_free.compare_exchange_weak(head, (tag << 32) | next, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            return node;
+        }
+    }
+
+    // Pool exhausted
+    return new Node();
+}
+
+template <typename T, std::size_t PoolSize>
+void MpscQueue<T, PoolSize>::release(Node* node) noexcept
+{
+    // Drop the (moved from) value now, not when the node is reused
+    node->value = T{};
+
+    const auto* first = m_pool.get();
+
+    if (std::less<const Node*>()(node, first) || !std::less<const Node*>()(node, first + PoolSize))
+    {
+        delete node;
+        return;
+    }
+
+    const auto index = static_cast<std::uint32_t>(node - first);
+    auto head = m_free.load(std::memory_order_relaxed);
+
+    do
+    {
+        node->nextFree.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+    }
+    while (!m_free.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | index, std::memory_order_release, std::memory_order_relaxed));
+}
+
+
+// Tasks posted from any thread, run by the thread owning the dispatcher
+// (the UserInterface runs its own one every frame)
+class Dispatcher
+{
+    public:
+
+        // Stored in the queue nodes: posting doesn't allocate
+        using t_task = InplaceFunction<void(), 8 * sizeof(void*)>;
+
+
+        // Any thread, never blocks
+        void post(t_task&& task);
+
+        // Owner thread: run the posted tasks, returns how many
+        auto processQueued() -> std::size_t;
+
+
+    private:
+
+        MpscQueue<t_task> m_queue;
+
+};
+
+
+// cpp
+// Any thread, never blocks
+void Dispatcher::post(t_task&& task)
+{
+    m_queue.push(std::move(task));
+}
+
+// Owner thread: run the posted tasks, returns how many
+auto Dispatcher::processQueued() -> std::size_t
+{
+    std::size_t count = 0;
+    t_task task;
+
+    while (m_queue.pop(task))
+    {
+        task();
+        ++count;
+    }
+
+    return count;
+}
+
+
+// ----------------------------------------------------------------
+// Signal with any number of subscribers
+// - Direct slots are called by emit()
+// - Queued slots are posted to a dispatcher, and called by its thread
+//   (the arguments are copied)
+// Connections are made on the emitting thread (or before other threads emit)
+// The first slot is stored inside the signal: connecting it doesn't allocate
+// ----------------------------------------------------------------
+template <typename... Args>
+class Signal
+{
+    public:
+
+        using t_slot = InplaceFunction<void(Args...)>;
+        using t_connection = std::uint32_t;
+
+
+    public:
+
+        // ctor
+        Signal() = default;
+
+        // dtor (queued calls not delivered yet are dropped)
+        ~Signal();
+
+        Signal(const Signal&) = delete;
+        auto operator=(const Signal&) -> Signal& = delete;
+
+
+        // Called by emit()
+        auto connect(t_slot&& slot) -> t_connection;
+        // Called by the dispatcher thread
+        auto connect(t_slot&& slot, Dispatcher& dispatcher) -> t_connection;
+
+        // Queued calls not delivered yet are dropped too
+        void disconnect(t_connection connection);
+
+        // Call (or post) every slot
+        void emit(const Args&... args);
+
+        // Number of connected slots
+        auto size() const noexcept -> std::size_t;
+
+
+    private:
+
+        // Queued slot, shared with the calls not delivered yet: they check if it is still connected
+        // (allocated once, when connecting)
+        struct Queued
+        {
+            t_slot slot;
+            Dispatcher* dispatcher;
+            std::atomic<bool> connected{ true };
+            std::atomic<std::uint32_t> references{ 1 };
+        };
+
+        // Reference to a queued slot, owned by a posted call
+        class QueuedReference
+        {
+            public:
+
+                explicit QueuedReference(Queued* queued) noexcept : m_queued(queued)
+                {
+                    m_queued->references.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                QueuedReference(QueuedReference&& other) noexcept : m_queued(std::exchange(other.m_queued, nullptr)) {}
+
+                ~QueuedReference()
+                {
+                    if (m_queued)
+                        release(m_queued);
+                }
+
+                QueuedReference(const QueuedReference&) = delete;
+                auto operator=(const QueuedReference&) -> QueuedReference& = delete;
+                auto operator=(QueuedReference&&) -> QueuedReference& = delete;
+
+                auto operator->() const noexcept -> Queued* { return m_queued; }
+
+            private:
+
+                Queued* m_queued;
+        };
+
+        // Connected slot (direct slots are stored here, queued ones in their shared part)
+        struct Entry
+        {
+            t_connection id = 0;
+            t_slot slot;
+            Queued* queued = nullptr;
+            bool connected = false;
+        };
+
+
+        auto add(t_slot&& slot, Dispatcher* dispatcher) -> t_connection;
+
+        // Call (or post) one slot
+        void call(const Entry& entry, const Args&... args);
+
+        // Drop the slot of an entry (and its reference to the queued part)
+        static void reset(Entry& entry) noexcept;
+        static void release(Queued* queued) noexcept;
+
+        // Erase the disconnected slots (not while emitting)
+        void compact() noexcept;
+
+
+        // First slot (most signals only have one)
+        Entry m_first;
+        // The other ones (a list: connecting while emitting doesn't move them,
+        // and an empty list doesn't allocate)
+        std::list<Entry> m_others;
+
+        t_connection m_nextId = 0;
+
+        // Slots may disconnect while emitting: they are erased afterwards
+        std::uint32_t m_emitting = 0;
+
+};
+
+
+// --- Template functions implementation ---
+// dtor (queued calls not delivered yet are dropped)
+template <typename... Args>
+Signal<Args...>::~Signal()
+{
+    reset(m_first);
+
+    for (auto& entry : m_others)
+        reset(entry);
+}
+
+// Called by emit()
+template <typename... Args>
+auto Signal<Args...>::connect(t_slot&& slot) -> t_connection
+{
+    return add(std::move(slot), nullptr);
+}
+
+// Called by the dispatcher thread
+template <typename... Args>
+auto Signal<Args...>::connect(t_slot&& slot, Dispatcher& dispatcher) -> t_connection
+{
+    return add(std::move(slot), &dispatcher);
+}
+
+template <typename... Args>
+auto Signal<Args...>::add(t_slot&& slot, Dispatcher* dispatcher) -> t_connection
+{
+    // The first entry is free (compacted) unless emitting
+    auto& entry = (m_emitting == 0 && !m_first.connected) ? m_first : m_others.emplace_back();
+
+    reset(entry);
+    entry.id = m_nextId++;
+    entry.connected = true;
+
+    if (dispatcher)
+    {
+        entry.queued = new Queued();
+        entry.queued->slot = std::move(slot);
+        entry.queued->dispatcher = dispatcher;
+    }
+    else
+        entry.slot = std::move(slot);
+
+    return entry.id;
+}
+
+// Queued calls not delivered yet are dropped too
+template <typename... Args>
+void Signal<Args...>::disconnect(t_connection connection)
+{
+    const auto disconnect = [connection](Entry& entry)
+    {
+        if (!entry.connected || entry.id != connection)
+            return;
+
+        entry.connected = false;
+
+        if (entry.queued)
+            entry.queued->connected.store(false, std::memory_order_release);
+    };
+
+    disconnect(m_first);
+
+    for (auto& entry : m_others)
+        disconnect(entry);
+
+    if (m_emitting == 0)
+        compact();
+}
+
+// Call (or post) every slot
+template <typename... Args>
+void Signal<Args...>::emit(const Args&... args)
+{
+    ++m_emitting;
+
+    // Counted: slots may connect new slots (those are not called now)
+    const auto count = m_others.size();
+
+    if (m_first.connected)
+        call(m_first, args...);
+
+    auto entry = m_others.begin();
+
+    for (std::size_t i = 0; i < count; ++i, ++entry)
+        if (entry->connected)
+            call(*entry, args...);
+
+    // Erase the slots disconnected meanwhile
+    if (--m_emitting == 0)
+        compact();
+}
+
+// Number of connected slots
+template <typename... Args>
+auto Signal<Args...>::size() const noexcept -> std::size_t
+{
+    return (m_first.connected ? 1 : 0) + m_others.size();
+}
+
+// Call (or post) one slot
+template <typename... Args>
+void Signal<Args...>::call(const Entry& entry, const Args&... args)
+{
+    if (!entry.queued)
+    {
+        entry.slot(args...);
+        return;
+    }
+
+    entry.queued->dispatcher->post([queued = QueuedReference(entry.queued), values = std::tuple<std::decay_t<Args>...>(args...)]()
+    {
+        if (queued->connected.load(std::memory_order_acquire))
+            std::apply(queued->slot, values);
+    });
+}
+
+// Drop the slot of an entry (and its reference to the queued part)
+template <typename... Args>
+void Signal<Args...>::reset(Entry& entry) noexcept
+{
+    entry.slot = t_slot();
+    entry.connected = false;
+
+    if (entry.queued)
+    {
+        entry.queued->connected.store(false, std::memory_order_release);
+        release(std::exchange(entry.queued, nullptr));
+    }
+}
+
+template <typename... Args>
+void Signal<Args...>::release(Queued* queued) noexcept
+{
+    if (queued->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete queued;
+}
+
+// Erase the disconnected slots (not while emitting)
+template <typename... Args>
+void Signal<Args...>::compact() noexcept
+{
+    for (auto& entry : m_others)
+        if (!entry.connected)
+            reset(entry);
+
+    m_others.remove_if([](const Entry& entry) { return !entry.connected; });
+
+    // The next slot takes the first entry
+    if (!m_first.connected)
+    {
+        reset(m_first);
+
+        if (!m_others.empty())
+        {
+            m_first = std::move(m_others.front());
+            m_others.front().queued = nullptr;
+            m_others.pop_front();
+        }
+    }
+}
+
+
+
+// -------------------
+// Example GUI widgets
+// -------------------
+// Clickable button
+class Button final : public IWidget
+{
+
+    public:
+
+        // Widget type (static dispatch)
+        static constexpr e_widgetType TYPE = e_widgetType::BUTTON;
+
+        // Emitted on button click events
+        using t_clickedSignal = Signal<>;
+        // First subscriber, given to the ctor
+        using t_slot = t_clickedSignal::t_slot;
+
+        // Define button size
+        enum class e_buttonSize { SMALL, MEDIUM, LARGE };
+
+
+    public:
+
+        // ctor
+        Button(const WidgetInit& init,
+               Rect<float>&& dimension, std::string_view text, t_slot&& clickedSlot,
+               e_buttonSize buttonSize = e_buttonSize::SMALL);
+
+
+        // Virtual functions override:
+        void onClick(const SDL_Event& event) override;
+
+        // Mouse over/leave modify the hover state
+        void onMouseOver()  override;
+        void onMouseLeave() override;
+
+        // Accept a rendering visitor
+        void accept(RenderUI& renderer) const override;
+
+        // Getters:
+        auto getText() const noexcept -> std::string_view;
+        auto getButtonSize() const noexcept -> e_buttonSize;
+        auto isOnHover() const -> bool;
+
+        // Subscribe here to button clicks
+        auto getClickedSignal() noexcept -> t_clickedSignal&;
+
+
+    private:
+
+        // Button text
+        std::string m_text;
+        // Button size
+        e_buttonSize m_size;
+
+        // Hover status
+        bool m_hover;
+
+        // Button clicked event
+        t_clickedSignal m_clicked;
+
+};
+
+
+// cpp
+// ctor
+Button::Button(const WidgetInit& init,
+               Rect<float>&& dimension, std::string_view text, t_slot&& clickedSlot, e_buttonSize buttonSize)
+
+    : IWidget(TYPE, init, std::move(dimension)),
+
+      m_text(text),
+      m_size(buttonSize),
+      m_hover(false)
+{
+    if (clickedSlot)
+        m_clicked.connect(std::move(clickedSlot));
+}
+
+
+// Virtual functions override:
+void Button::onClick(const SDL_Event& event)
+{
+
+    cout << " -> Button::onClick() -> \'" << m_text << '\'' << endl;
+
+    // If left mouse button is clicked, notify the subscribers
+    if (event.button.button == SDL_BUTTON_LEFT)
+        m_clicked.emit();
+}
+
+// Mouse over/leave modify the hover state
+void Button::onMouseOver()
+{
+    m_hover = true;
+    markDirty();
+}
+
+void Button::onMouseLeave()
+{
+    m_hover = false;
+    markDirty();
+}
+
+
+// Accept a rendering visitor
+void Button::accept(RenderUI& renderer) const
+{
+    renderer.render(*this);
+}
+
+
+// Getters:
+auto Button::getText() const noexcept -> std::string_view
+{
+    return m_text;
+}
+
+auto Button::getButtonSize() const noexcept -> e_buttonSize
+{
+    return m_size;
+}
+
+auto Button::isOnHover() const -> bool
+{
+    return m_hover;
+}
+
+// Subscribe here to button clicks
+auto Button::getClickedSignal() noexcept -> t_clickedSignal&
+{
+    return m_clicked;
+}
+
+
+// A box that can be marked as checked
+class Checkbox final : public IWidget
+{
+
+    public:
+
+        // Widget type (static dispatch)
+        static constexpr e_widgetType TYPE = e_widgetType::CHECKBOX;
+
+        // The text starts at this many box widths, at the right of the box
+        static constexpr float TEXT_OFFSET = 1.25f;
+
+        // Emitted when the user toggles it (with the new status)
+        using t_toggledSignal = Signal<bool>;
+
+
+    public:
+
+        // ctor
+        Checkbox(const WidgetInit& init,
+                 Rect<float>&& dimension, std::string text,
+                 bool checked = false, bool grayedOut = false);
+
+
+        // Virtual functions override:
+        void onClick(const SDL_Event& event) override;
+
+        // Accept a rendering visitor
+        void accept(RenderUI& renderer) const override;
+
+        // The box and the text at its right
+        auto getDrawnArea() const noexcept -> Rect<float> override;
+
+        // Getters
+        auto getText() const noexcept -> std::string_view;
+        auto isChecked() const noexcept -> bool;
+        auto isGreyedOut() const noexcept -> bool;
+
+        // Setters
+        void setText(std::string_view text);
+        void setChecked(bool checked);
+
+        // Subscribe here to user toggles
+        auto getToggledSignal() noexcept -> t_toggledSignal&;
+
+
+    private:
+
+        // Optional text string
+        std::string m_text;
+
+        // User toggled event
+        t_toggledSignal m_toggled;
+
+        // Current status
+        bool m_checked;
+        // Can it be checked?
+        // or is it grayed out?
+        bool m_greyedOut;
+
+};
+
+
+// cpp
+// ctor
+Checkbox::Checkbox(const WidgetInit& init,
+                   Rect<float>&& dimension, std::string text, bool checked, bool grayedOut)
+
+    : IWidget(TYPE, init, std::move(dimension)),
+
+      m_text(std::move(text)),
+      m_checked(checked),
+      m_greyedOut(grayedOut)
+{
+}
+
+
+// Virtual functions override:
+void Checkbox::onClick(const SDL_Event& event)
+{
+    cout << " -> Checkbox::onClick() -> \'" << m_text << '\'' << endl;
+
+    // If it's not disabled, toggle checked status
+    if (!m_greyedOut && event.button.button == SDL_BUTTON_LEFT)
+    {
+        m_checked = !m_checked;
+        markDirty();
+
+        m_toggled.emit(m_checked);
+    }
+}
+
+// Accept a rendering visitor
+void Checkbox::accept(RenderUI& renderer) const
+{
+    renderer.render(*this);
+}
+
+// The box and the text at its right
+// (the text is measured by the backends, this is an upper bound)
+auto Checkbox::getDrawnArea() const noexcept -> Rect<float>
+{
+    const auto dimension = getDimension();
+
+    if (m_text.empty())
+        return dimension;
+
+    return { dimension.x, dimension.y,
+             dimension.w * TEXT_OFFSET + static_cast<float>(m_text.size()) * dimension.h * DrawCommand::MAX_GLYPH_WIDTH, dimension.h };
+}
+
+
+// Getters
+auto Checkbox::getText() const noexcept -> std::string_view
+{
+    return m_text;
+}
+
+auto Checkbox::isChecked() const noexcept -> bool
+{
+    return m_checked;
+}
+
+auto Checkbox::isGreyedOut() const noexcept -> bool
+{
+    return m_greyedOut;
+}
+
+
+// Setters
+void Checkbox::setText(std::string_view text)
+{
+    if (m_text == text)
+        return;
+
+    m_text = text;
+    markDirty();
+}
+
+void Checkbox::setChecked(bool checked)
+{
+    if (m_checked == checked)
+        return;
+
+    m_checked = checked;
+    markDirty();
+}
+
+
+// Subscribe here to user toggles
+auto Checkbox::getToggledSignal() noexcept -> t_toggledSignal&
+{
+    return m_toggled;
+}
+
+
+// Container of other widgets (children are positioned relative to it,
+// and are expected to stay inside it)
+class Panel final : public IWidget
+{
+
+    public:
+
+        // Widget type (static dispatch)
+        static constexpr e_widgetType TYPE = e_widgetType::PANEL;
+
+        // Rounded frame corners
+        static constexpr float CORNER_RADIUS = 6.0f;
+
+        // ctor
+        Panel(const WidgetInit& init, Rect<float>&& dimension);
+
+
+        // Accept a rendering visitor
+        void accept(RenderUI& renderer) const override;
+
+        // Opaque inside the rounded corners
+        auto getOpaqueArea() const noexcept -> Rect<float> override;
+
+};
+
+
+// cpp
+// ctor
+Panel::Panel(const WidgetInit& init, Rect<float>&& dimension)
+    : IWidget(TYPE, init, std::move(dimension))
+{
+}
+
+// Accept a rendering visitor
+void Panel::accept(RenderUI& renderer) const
+{
+    renderer.render(*this);
+}
+
+// Opaque inside the rounded corners
+auto Panel::getOpaqueArea() const noexcept -> Rect<float>
+{
+    const auto dimension = getDimension();
+
+    return { dimension.x + CORNER_RADIUS, dimension.y + CORNER_RADIUS,
+             std::max(dimension.w - 2.0f * CORNER_RADIUS, 0.0f), std::max(dimension.h - 2.0f * CORNER_RADIUS, 0.0f) };
+}
+
+
+// Scrollable list with a huge number of rows
+// Only the rows inside the viewport exist: a small pool of row widgets is
+// recycled while scrolling, and the binder fills them with the row data
+class ListView final : public IWidget
+{
+
+    public:
+
+        // Widget type (static dispatch)
+        static constexpr e_widgetType TYPE = e_widgetType::LIST_VIEW;
+
+        // Fills a row widget with the data of a row
+        using t_rowBinder = InplaceFunction<void(std::size_t row, Checkbox& widget)>;
+
+        // Pixels per mouse wheel step
+        static constexpr float SCROLL_STEP = 40.0f;
+
+
+    public:
+
+        // ctor
+        ListView(const WidgetInit& init, Rect<float>&& dimension, t_rowBinder&& binder);
+
+
+        // Rows with the same height (row from scroll offset is O(1))
+        void setRows(std::size_t count, float rowHeight);
+        // Rows with different heights (row from scroll offset is a binary search on the prefix sums)
+        void setRows(const std::vector<float>& heights);
+
+        // Bind the visible rows again (the data changed, not the row count)
+        void refresh();
+
+        // Scroll (clamped to the content)
+        void scrollTo(double offset);
+        void scrollBy(double delta);
+
+        // Virtual functions override:
+        void onMouseScroll(const SDL_Event& event) override;
+
+        // Accept a rendering visitor
+        void accept(RenderUI& renderer) const override;
+
+        // Square frame: opaque everywhere
+        auto getOpaqueArea() const noexcept -> Rect<float> override;
+
+        // Getters:
+        auto getRowCount() const noexcept -> std::size_t;
+        auto getScrollOffset() const noexcept -> double;
+        // Row at a vertical position inside the content
+        auto rowAt(double offset) const noexcept -> std::size_t;
+
+
+    private:
+
+        // Row geometry inside the content
+        // (in double: a float is off by pixels after a few million rows)
+        auto rowOffset(std::size_t row) const noexcept -> double;
+        auto rowHeight(std::size_t row) const noexcept -> float;
+        auto contentHeight() const noexcept -> double;
+
+        // Enough row widgets to fill the viewport with the smallest rows
+        void createRowWidgets(float minRowHeight);
+
+        // Bind and place the row widgets for the current scroll offset
+        void layoutRows();
+
+
+        // To create the row widgets
+        WidgetInit m_init;
+
+        // Row data source
+        t_rowBinder m_binder;
+
+        // Number of rows and their height (if they are all the same)
+        std::size_t m_rowCount;
+        float m_rowHeight;
+        // Prefix sums of the row heights (rowCount + 1 values, empty if they are all the same)
+        std::vector<double> m_rowOffsets;
+
+        // Scroll position, in pixels
+        double m_scrollOffset;
+
+        // Recycled row widgets, row N always goes to widget N % size
+        std::vector<std::unique_ptr<Checkbox>> m_rowWidgets;
+        // Row currently bound to every widget
+        std::vector<std::size_t> m_boundRows;
+        // Widgets holding a visible row (member to reuse its memory)
+        std::vector<bool> m_usedRowWidgets;
+
+};
+
+
+// cpp
+// ctor
+ListView::ListView(const WidgetInit& init, Rect<float>&& dimension, t_rowBinder&& binder)
+    : IWidget(TYPE, init, std::move(dimension)),
+
+      m_init(init),
+      m_binder(std::move(binder)),
+
+      m_rowCount(0),
+      m_rowHeight(0.0f),
+
+      m_scrollOffset(0.0)
+{
+}
+
+
+// Rows with the same height (row from scroll offset is O(1))
+void ListView::setRows(std::size_t count, float rowHeight)
+{
+    m_rowCount  = count;
+    m_rowHeight = std::max(1.0f, rowHeight);
+    m_rowOffsets.clear();
+
+    createRowWidgets(m_rowHeight);
+    scrollTo(m_scrollOffset);
+}
+
+// Rows with different heights (row from scroll offset is a binary search on the prefix sums)
+void ListView::setRows(const std::vector<float>& heights)
+{
+    m_rowCount = heights.size();
+    m_rowOffsets.resize(heights.size() + 1);
+    m_rowOffsets[0] = 0.0;
+
+    auto minRowHeight = getLocalDimension().h;
+
+    for (std::size_t row = 0; row < heights.size(); ++row)
+    {
+        const auto height = std::max(1.0f, heights[row]);
+
+        m_rowOffsets[row + 1] = m_rowOffsets[row] + height;
+        minRowHeight = std::min(minRowHeight, height);
+    }
+
+    createRowWidgets(minRowHeight);
+    scrollTo(m_scrollOffset);
+}
+
+// Bind the visible rows again (the data changed, not the row count)
+void ListView::refresh()
+{
+    m_boundRows.assign(m_rowWidgets.size(), m_rowCount);
+
+    layoutRows();
+}
+
+
+// Scroll (clamped to the content)
+void ListView::scrollTo(double offset)
+{
+    m_scrollOffset = std::clamp(offset, 0.0, std::max(0.0, contentHeight() - getLocalDimension().h));
+
+    layoutRows();
+}
+
+void ListView::scrollBy(double delta)
+{
+    scrollTo(m_scrollOffset + delta);
+}
+
+
+// Virtual functions override:
+void ListView::onMouseScroll(const SDL_Event& event)
+{
+    // Wheel up (positive) goes back to the first rows
+    scrollBy(-static_cast<double>(event.wheel.y) * SCROLL_STEP);
+}
+
+// Accept a rendering visitor
+void ListView::accept(RenderUI& renderer) const
+{
+    renderer.render(*this);
+}
+
+// Square frame: opaque everywhere
+auto ListView::getOpaqueArea() const noexcept -> Rect<float>
+{
+    return getDimension();
+}
+
+
+// Getters:
+auto ListView::getRowCount() const noexcept -> std::size_t
+{
+    return m_rowCount;
+}
+
+auto ListView::getScrollOffset() const noexcept -> double
+{
+    return m_scrollOffset;
+}
+
+// Row at a vertical position inside the content
+auto ListView::rowAt(double offset) const noexcept -> std::size_t
+{
+    if (m_rowCount == 0 || offset <= 0.0)
+        return 0;
+
+    // Same height: direct division
+    if (m_rowOffsets.empty())
+        return std::min(m_rowCount - 1, static_cast<std::size_t>(offset / m_rowHeight));
+
+    // Last row starting at (or before) the offset
+    const auto found = std::upper_bound(m_rowOffsets.begin(), m_rowOffsets.end(), offset);
+
+    return std::min(m_rowCount - 1, static_cast<std::size_t>(found - m_rowOffsets.begin()) - 1);
+}
+
+
+// Row geometry inside the content
+auto ListView::rowOffset(std::size_t row) const noexcept -> double
+{
+    return m_rowOffsets.empty() ? static_cast<double>(row) * m_rowHeight : m_rowOffsets[row];
+}
+
+auto ListView::rowHeight(std::size_t row) const noexcept -> float
+{
+    return m_rowOffsets.empty() ? m_rowHeight : static_cast<float>(m_rowOffsets[row + 1] - m_rowOffsets[row]);
+}
+
+auto ListView::contentHeight() const noexcept -> double
+{
+    return m_rowOffsets.empty() ? static_cast<double>(m_rowCount) * m_rowHeight : m_rowOffsets.back();
+}
+
+
+// Enough row widgets to fill the viewport with the smallest rows
+void ListView::createRowWidgets(float minRowHeight)
+{
+    // +1: a partially visible row at the top and at the bottom
+    const auto needed = std::min(m_rowCount, static_cast<std::size_t>(std::ceil(getLocalDimension().h / minRowHeight)) + 1);
+
+    while (m_rowWidgets.size() < needed)
+    {
+        auto& widget = m_rowWidgets.emplace_back(std::make_unique<Checkbox>(m_init, Rect<float>{}, std::string{}));
+
+        widget->setVisibility(false);
+        addChildren(widget.get());
+        widget->setObserver(m_observer);
+    }
+
+    // Rows are bound again (new data, and the widget of every row changes with the pool size)
+    m_boundRows.assign(m_rowWidgets.size(), m_rowCount);
+    m_usedRowWidgets.resize(m_rowWidgets.size(), false);
+}
+
+// Bind and place the row widgets for the current scroll offset
+void ListView::layoutRows()
+{
+    if (m_rowWidgets.empty())
+        return;
+
+    const auto first = rowAt(m_scrollOffset);
+    const auto poolSize = m_rowWidgets.size();
+
+    // Which widgets hold a visible row
+    std::fill(m_usedRowWidgets.begin(), m_usedRowWidgets.end(), false);
+
+    for (auto row = first; row < m_rowCount && row - first < poolSize; ++row)
+    {
+        // Small inside the viewport: a float is enough
+        const auto top = static_cast<float>(rowOffset(row) - m_scrollOffset);
+        if (top >= getLocalDimension().h)
+            break;
+
+        const auto slot = row % poolSize;
+        auto& widget = *m_rowWidgets[slot];
+        m_usedRowWidgets[slot] = true;
+
+        // Only rows new to the viewport are bound
+        if (m_boundRows[slot] != row)
+        {
+            m_binder(row, widget);
+            m_boundRows[slot] = row;
+        }
+
+        // Check box as high as the row, label on its right
+        const auto local = widget.getLocalDimension();
+        const auto height = rowHeight(row);
+
+        if (local.w != height || local.h != height)
+            widget.resizeTo({ height, height });
+        if (local.x != 0.0f || local.y != top)
+            widget.moveTo({ 0.0f, top });
+
+        widget.setVisibility(true);
+    }
+
+    // The rest of the pool is not needed
+    for (std::size_t slot = 0; slot < poolSize; ++slot)
+        if (!m_usedRowWidgets[slot])
+            m_rowWidgets[slot]->setVisibility(false);
+}
+
+
+
+// ---------------------------------------------------------------
+// Compile-time visitor: calls the visitor with the concrete widget
+// class, found from getWidgetType() (no virtual call, no IWidget
+// changes for new visitors: layout, serialization, hit-testing...)
+// Every class in the list must have its own TYPE
+// ---------------------------------------------------------------
+template <typename... Widgets>
+struct WidgetTypeList
+{
+};
+
+// Widget classes known at compile time
+using t_widgetTypes = WidgetTypeList<Panel, Checkbox, Button, ListView>;
+
+
+// Several lambdas as one visitor (one per widget class)
+template <typename... Lambdas>
+struct Overloaded : Lambdas...
+{
+    using Lambdas::operator()...;
+};
+
+template <typename... Lambdas>
+Overloaded(Lambdas...) -> Overloaded<Lambdas...>;
+
+
+// Const (or not) like From
+template <typename From, typename To>
+using t_sameConst = std::conditional_t<std::is_const_v<From>, const To, To>;
+
+// Calls visitor(concreteWidget), false if the class is not in the list
+template <typename WidgetBase, typename Visitor, typename... Widgets>
+auto visitWidget(WidgetBase& widget, Visitor&& visitor, WidgetTypeList<Widgets...>) -> bool
+{
+    static_assert(std::is_base_of_v<IWidget, std::remove_const_t<WidgetBase>>, "<WidgetBase> MUST be IWidget");
+
+    const auto type = widget.getWidgetType();
+
+    return ((type == Widgets::TYPE
+             ? (visitor(static_cast<t_sameConst<WidgetBase, Widgets>&>(widget)), true)
+             : false) || ...);
+}
+
+// Same, with the known widget classes
+template <typename WidgetBase, typename Visitor>
+auto visitWidget(WidgetBase& widget, Visitor&& visitor) -> bool
+{
+    return visitWidget(widget, std::forward<Visitor>(visitor), t_widgetTypes{});
+}
+
+
+
+// ---------------------------------------------
+// Renderer (Visitor) and console backend
+// The widgets are known here, so this goes after
+// ---------------------------------------------
+namespace colors
+{
+    constexpr std::uint32_t BACKGROUND   = 0x202020FF;
+    constexpr std::uint32_t WIDGET       = 0x3C3C3CFF;
+    constexpr std::uint32_t WIDGET_HOVER = 0x505A6EFF;
+    constexpr std::uint32_t WIDGET_GREY  = 0x2A2A2AFF;
+    constexpr std::uint32_t BORDER       = 0x787878FF;
+    constexpr std::uint32_t PANEL        = 0x2E2E2EFF;
+    constexpr std::uint32_t TEXT         = 0xE6E6E6FF;
+    constexpr std::uint32_t TEXT_GREY    = 0x808080FF;
+    constexpr std::uint32_t CHECK_MARK   = 0x6EC85AFF;
+}
+
+// Icons inside the ICONS texture
+enum class e_icon : std::uint32_t
+{
+    CHECK_MARK
+};
+
+
+// cpp
+// ctor
+RenderUI::RenderUI(IRenderBackend& backend)
+    : m_backend(&backend),
+      m_renderThread(nullptr),
+      m_levelTiles(LEVEL_GRID * LEVEL_GRID)
+{
+}
+
+// ctor (frames are drawn by the render thread)
+RenderUI::RenderUI(RenderThread& renderThread)
+    : m_backend(nullptr),
+      m_renderThread(&renderThread),
+      m_levelTiles(LEVEL_GRID * LEVEL_GRID)
+{
+}
+
+
+// Record every widget type (Visitor)
+void RenderUI::render(const Checkbox& widget)
+{
+    const auto dimension = widget.getDimension();
+    const auto textColor  = widget.isGreyedOut() ? colors::TEXT_GREY : colors::TEXT;
+
+    // Box, check mark and the text at its right
+    pushFrame(dimension, widget.isGreyedOut() ? colors::WIDGET_GREY : colors::WIDGET, colors::BORDER, 4.0f);
+
+    if (widget.isChecked())
+    {
+        const auto padding = dimension.w * 0.2f;
+
+        pushImage({ dimension.x + padding, dimension.y + padding, dimension.w - 2.0f * padding, dimension.h - 2.0f * padding },
+                  static_cast<std::uint32_t>(e_icon::CHECK_MARK), colors::CHECK_MARK);
+    }
+
+    if (!widget.getText().empty())
+        pushText({ dimension.x + dimension.w * Checkbox::TEXT_OFFSET, dimension.y, 0.0f, dimension.h }, widget.getText(), textColor);
+}
+
+void RenderUI::render(const Button& widget)
+{
+    const auto dimension = widget.getDimension();
+
+    // Background and the text inside
+    pushFrame(dimension, widget.isOnHover() ? colors::WIDGET_HOVER : colors::WIDGET, colors::BORDER, 8.0f);
+    pushText(dimension, widget.getText(), colors::TEXT);
+}
+
+
+void RenderUI::render(const Panel& widget)
+{
+    pushFrame(widget.getDimension(), colors::PANEL, colors::BORDER, Panel::CORNER_RADIUS);
+}
+
+
+void RenderUI::render(const ListView& widget)
+{
+    pushFrame(widget.getDimension(), colors::PANEL, colors::BORDER, 0.0f);
+}
+
+
+// Restore the background under a dirty region
+void RenderUI::clear(const Rect<float>& region)
+{
+    pushQuad(DrawCommand::e_layer::CLEAR, region, colors::BACKGROUND);
+}
+
+
+// Sort the recorded commands by state, merge them into batches
+// and submit them to the backend
+void RenderUI::flush()
+{
+    auto& commands = m_frame.commands;
+    auto& batches  = m_frame.batches;
+
+    // Drawing order first: widget layer, background clears, then the widgets draw order
+    // Stable: the commands of a widget share its draw order, and keep their recording order
+    std::stable_sort(commands.begin(), commands.end(), [](const DrawCommand& a, const DrawCommand& b)
+    {
+        const auto clearA = a.getLayer() == DrawCommand::e_layer::CLEAR;
+        const auto clearB = b.getLayer() == DrawCommand::e_layer::CLEAR;
+
+        if (a.getWidgetLayer() != b.getWidgetLayer())
+            return a.getWidgetLayer() < b.getWidgetLayer();
+        if (clearA != clearB)
+            return clearA;
+
+        return a.getSequence() < b.getSequence();
+    });
+
+    // Then by state, where it doesn't change what overlapping commands look like
+    // (too many levels: drawn in order, only the consecutive commands are batched)
+    if (assignLevels())
+    {
+        std::sort(commands.begin(), commands.end(), [](const DrawCommand& a, const DrawCommand& b)
+        {
+            return a.sortKey < b.sortKey;
+        });
+    }
+
+    // Merge the runs of commands sharing the same state
+    batches.clear();
+
+    for (std::uint32_t i = 0; i < commands.size(); ++i)
+    {
+        const auto& command = commands[i];
+
+        if (!batches.empty() && commands[batches.back().first].sameState(command))
+            ++batches.back().count;
+        else
+            batches.push_back({ command.getType(), command.getLayer(), command.getMaterial(), command.getTexture(), i, 1 });
+    }
+
+    // The render thread takes the list and gives back an empty one
+    if (m_renderThread)
+        m_renderThread->submit(m_frame);
+    else
+        m_frame.draw(*m_backend);
+
+    // Ready for the next frame
+    m_frame.clear();
+    m_drawOrder = -1;
+    m_opacity = 1.0f;
+    m_widgetLayer = 0;
+}
+
+
+// Level of every command (in drawing order), false if there are too many of them
+// A command goes one level above the overlapped commands with another state,
+// and stays at their level if they share its state (the sequence keeps their order)
+auto RenderUI::assignLevels() noexcept -> bool
+{
+    constexpr std::uint32_t MIXED = UINT32_MAX;
+
+    auto& commands = m_frame.commands;
+
+    if (commands.size() > DrawCommand::MAX_SEQUENCE + std::size_t{1})
+        return false;
+
+    std::int32_t widgetLayer = -1;
+
+    for (std::uint32_t i = 0; i < commands.size(); ++i)
+    {
+        auto& command = commands[i];
+
+        // Higher widget layers are drawn after anyway
+        if (command.getWidgetLayer() != widgetLayer)
+        {
+            widgetLayer = command.getWidgetLayer();
+
+            for (auto& tile : m_levelTiles)
+                tile.count = 0;
+
+            m_stateLevels.clear();
+        }
+
+        // Covered area, text may go outside its rectangle
+        auto rect = command.rect;
+
+        if (command.getType() == DrawCommand::e_type::TEXT)
+        {
+            const auto width = std::max(rect.w, static_cast<float>(command.length) * rect.h * DrawCommand::MAX_GLYPH_WIDTH);
+
+            rect.x -= rect.w > 0.0f ? (width - rect.w) * 0.5f : 0.0f;
+            rect.w  = width;
+        }
+
+        // Covered tiles (all of them if the area is too big or not finite)
+        std::int64_t tiles[4] = { 0, 0, LEVEL_GRID - 1, LEVEL_GRID - 1 };
+        const float  edges[4] = { rect.x, rect.y, rect.x + rect.w, rect.y + rect.h };
+
+        if (std::all_of(edges, edges + 4, [](float edge) { return std::abs(edge) < 1.0e9f; }))
+        {
+            for (int e = 0; e < 4; ++e)
+                tiles[e] = static_cast<std::int64_t>(std::floor(edges[e] / LEVEL_TILE_SIZE));
+
+            for (int axis = 0; axis < 2; ++axis)
+            {
+                if (tiles[axis + 2] - tiles[axis] >= LEVEL_GRID - 1)
+                {
+                    tiles[axis]     = 0;
+                    tiles[axis + 2] = LEVEL_GRID - 1;
+                }
+            }
+        }
+        else
+            rect = { -1.0e30f, -1.0e30f, 2.0e30f, 2.0e30f };
+
+        const auto forEachTile = [&](auto&& function)
+        {
+            for (auto y = tiles[1]; y <= tiles[3]; ++y)
+                for (auto x = tiles[0]; x <= tiles[2]; ++x)
+                    function(m_levelTiles[static_cast<std::size_t>((y & (LEVEL_GRID - 1)) * LEVEL_GRID + (x & (LEVEL_GRID - 1)))]);
+        };
+
+        const auto state = command.getState();
+        std::uint32_t level = 0;
+
+        forEachTile([&](const LevelTile& tile)
+        {
+            for (std::uint32_t e = 0; e < tile.count; ++e)
+            {
+                const auto& entry = tile.entries[e];
+
+                if (intersects(entry.rect, rect))
+                    level = std::max(level, entry.level + (entry.state != state ? 1u : 0u));
+            }
+        });
+
+        // Going higher is allowed: the same state is already drawn there
+        auto stateLevel = std::find_if(m_stateLevels.begin(), m_stateLevels.end(), [state](const auto& known) { return known.first == state; });
+
+        if (stateLevel == m_stateLevels.end())
+            m_stateLevels.emplace_back(state, level);
+        else if (stateLevel->second >= level)
+            level = stateLevel->second;
+        else
+            stateLevel->second = level;
+
+        // Too many: back to the drawing order
+        if (level > DrawCommand::MAX_LEVEL)
+        {
+            for (std::uint32_t j = 0; j < commands.size(); ++j)
+                commands[j].setOrder(0, j);
+
+            return false;
+        }
+
+        forEachTile([&](LevelTile& tile)
+        {
+            // Hidden below this command: it says more about the commands coming after
+            std::uint32_t count = 0;
+
+            for (std::uint32_t e = 0; e < tile.count; ++e)
+            {
+                const auto& entry = tile.entries[e];
+
+                if (!covers(rect, entry.rect) || level < entry.level + (entry.state != state ? 1u : 0u))
+                    tile.entries[count++] = entry;
+            }
+
+            // Full: the two oldest become one, at least as high as both
+            if (count == std::size(tile.entries))
+            {
+                auto& oldest = tile.entries[0];
+                const auto& next = tile.entries[1];
+
+                oldest = { merge(oldest.rect, next.rect), oldest.state == next.state ? oldest.state : MIXED, std::max(oldest.level, next.level) };
+
+                std::copy(tile.entries + 2, tile.entries + count, tile.entries + 1);
+                --count;
+            }
+
+            tile.entries[count++] = { rect, state, level };
+            tile.count = count;
+        });
+
+        command.setOrder(level, i);
+    }
+
+    return true;
+}
+
+
+// Frame being recorded (for profiling)
+auto RenderUI::getRecordedFrame() const noexcept -> const RenderList&
+{
+    return m_frame;
+}
+
+// The next commands are drawn in this order (not in recording order)
+void RenderUI::setDrawOrder(std::uint32_t order) noexcept
+{
+    m_drawOrder = order;
+}
+
+// The alpha of the next commands is multiplied by this opacity
+void RenderUI::setOpacity(float opacity) noexcept
+{
+    m_opacity = opacity;
+}
+
+// The next commands are drawn after every command of the lower widget layers
+void RenderUI::setWidgetLayer(std::uint8_t layer) noexcept
+{
+    m_widgetLayer = layer;
+}
+
+
+// Record a command
+void RenderUI::push(DrawCommand::e_type type, DrawCommand::e_layer layer, DrawCommand::e_material material,
+                    DrawCommand::e_texture texture, const Rect<float>& rect, std::uint32_t color,
+                    std::uint32_t offset, std::uint32_t length, float radius)
+{
+    const auto sequence = static_cast<std::uint32_t>(m_drawOrder >= 0 ? m_drawOrder : static_cast<std::int64_t>(m_frame.commands.size()));
+
+    // Colors are RGBA, alpha in the low byte
+    if (m_opacity < 1.0f)
+        color = (color & 0xFFFFFF00u) | static_cast<std::uint32_t>(static_cast<float>(color & 0xFFu) * m_opacity + 0.5f);
+
+    m_frame.commands.push_back({ DrawCommand::makeSortKey(m_widgetLayer, layer, material, texture, type, sequence), rect, color, offset, length, radius });
+}
+
+void RenderUI::pushQuad(DrawCommand::e_layer layer, const Rect<float>& rect, std::uint32_t color, float radius)
+{
+    push(DrawCommand::e_type::QUAD, layer, DrawCommand::e_material::SOLID, DrawCommand::e_texture::NONE, rect, color, 0, 0, radius);
+}
+
+// Rounded quad with a border (two quads)
+void RenderUI::pushFrame(const Rect<float>& rect, std::uint32_t fill, std::uint32_t border, float radius)
+{
+    constexpr float BORDER_WIDTH = 1.0f;
+
+    pushQuad(DrawCommand::e_layer::BACKGROUND, rect, border, radius);
+    pushQuad(DrawCommand::e_layer::BACKGROUND,
+             { rect.x + BORDER_WIDTH, rect.y + BORDER_WIDTH, rect.w - 2.0f * BORDER_WIDTH, rect.h - 2.0f * BORDER_WIDTH },
+             fill, radius - BORDER_WIDTH);
+}
+
+void RenderUI::pushImage(const Rect<float>& rect, std::uint32_t icon, std::uint32_t color)
+{
+    push(DrawCommand::e_type::IMAGE, DrawCommand::e_layer::CONTENT, DrawCommand::e_material::TEXTURED,
+         DrawCommand::e_texture::ICONS, rect, color, icon);
+}
+
+void RenderUI::pushText(const Rect<float>& rect, std::string_view text, std::uint32_t color)
+{
+    const auto offset = static_cast<std::uint32_t>(m_frame.text.size());
+    m_frame.text.append(text);
+
+    push(DrawCommand::e_type::TEXT, DrawCommand::e_layer::TEXT, DrawCommand::e_material::GLYPHS,
+         DrawCommand::e_texture::FONT, rect, color, offset, static_cast<std::uint32_t>(text.size()));
+}
+
+
+// Prints the draw calls
+void ConsoleBackend::drawBatch(const DrawBatch& batch, const std::vector<DrawCommand>& commands, std::string_view text)
+{
+    switch (batch.type)
+    {
+        case DrawCommand::e_type::QUAD:
+            cout << "- Draw call: " << batch.count << " quad(s)" << endl;
+            break;
+
+        case DrawCommand::e_type::IMAGE:
+            cout << "- Draw call: " << batch.count << " image(s)" << endl;
+            break;
+
+        case DrawCommand::e_type::TEXT:
+            cout << "- Draw call: " << batch.count << " text run(s):";
+            for (auto i = batch.first; i < batch.first + batch.count; ++i)
+                cout << " \'" << text.substr(commands[i].offset, commands[i].length) << '\'';
+            cout << endl;
+            break;
+    }
+}
+
+
+// Submit every batch, then end the frame
+void RenderList::draw(IRenderBackend& backend) const
+{
+    for (const auto& batch : batches)
+        backend.drawBatch(batch, commands, text);
+
+    backend.endFrame();
+}
+
+// Empty, the memory is kept
+void RenderList::clear() noexcept
+{
+    commands.clear();
+    text.clear();
+    batches.clear();
+}
+
+
+// ctor (the backend is only used by this thread from now on)
+RenderThread::RenderThread(IRenderBackend& backend)
+    : m_backend(backend),
+      m_thread(&RenderThread::run, this)
+{
+}
+
+// dtor (draws the waiting frame first)
+RenderThread::~RenderThread()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_changed.notify_all();
+    m_thread.join();
+}
+
+// Hand over a frame, frame gets back an empty list (its memory is reused)
+void RenderThread::submit(RenderList& frame)
+{
+    {
+        std::unique_lock lock(m_mutex);
+
+        // The previous frame must be taken first: frames are never dropped
+        // (only the dirty regions are drawn, every frame is needed)
+        m_changed.wait(lock, [this]() { return !m_hasPending; });
+
+        std::swap(frame, m_pending);
+        m_hasPending = true;
+    }
+
+    m_changed.notify_all();
+    frame.clear();
+}
+
+// Wait until every submitted frame is drawn
+void RenderThread::waitIdle()
+{
+    std::unique_lock lock(m_mutex);
+    m_changed.wait(lock, [this]() { return !m_hasPending && !m_busy; });
+}
+
+// Thread loop
+void RenderThread::run()
+{
+    while (true)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_changed.wait(lock, [this]() { return m_hasPending || m_stop; });
+
+            if (!m_hasPending)
+                return;
+
+            std::swap(m_pending, m_drawing);
+            m_hasPending = false;
+            m_busy = true;
+        }
+
+        // The UI thread can submit the next frame meanwhile
+        m_changed.notify_all();
+
+        m_drawing.draw(m_backend);
+        m_drawing.clear();
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_busy = false;
+        }
+
+        m_changed.notify_all();
+    }
+}
+
+
+
+// --------------------------------------------------
+// Thread pool: fixed set of workers running tasks
+// --------------------------------------------------
+class ThreadPool
+{
+    public:
+
+        using t_task = std::function<void()>;
+
+
+    public:
+
+        // ctor (0 = one worker per core)
+        explicit ThreadPool(std::size_t workers = 0);
+
+        // dtor (finishes the queued tasks)
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+
+        // Run a task on a worker
+        void submit(t_task&& task);
+
+        // Run func(0) ... func(count - 1) on the workers and the calling thread, returns when all are done
+        // (must not be called from a task, it would wait for its own worker)
+        template <typename Func>
+        void parallelFor(std::size_t count, Func&& func);
+
+        // Number of workers
+        auto size() const noexcept -> std::size_t;
+
+
+    private:
+
+        // Worker loop
+        void run();
+
+
+        std::vector<std::thread> m_workers;
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::vector<t_task> m_tasks;
+        bool m_stop;
+
+};
+
+
+// cpp
+// ctor (0 = one worker per core)
+ThreadPool::ThreadPool(std::size_t workers)
+    : m_stop(false)
+{
+    if (workers == 0)
+        workers = std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t i = 0; i < workers; ++i)
+        m_workers.emplace_back(&ThreadPool::run, this);
+}
+
+// dtor (finishes the queued tasks)
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+
+// Run a task on a worker
+void ThreadPool::submit(t_task&& task)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+
+    m_condition.notify_one();
+}
+
+// Run func(0) ... func(count - 1) on the workers and the calling thread, returns when all are done
+template <typename Func>
+void ThreadPool::parallelFor(std::size_t count, Func&& func)
+{
+    // Every thread grabs the next index until there are none left
+    std::atomic<std::size_t> next{ 0 };
+
+    // Threads still working on it, the state below lives on this stack
+    // so the caller must wait for every one of them
+    const auto helpers = std::min(m_workers.size(), count > 0 ? count - 1 : 0);
+    std::size_t running = helpers + 1;
+
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    const auto work = [&]()
+    {
+        for (auto index = next++; index < count; index = next++)
+            func(index);
+
+        std::lock_guard lock(mutex);
+        if (--running == 0)
+            finished.notify_one();
+    };
+
+    for (std::size_t i = 0; i < helpers; ++i)
+        submit(work);
+
+    work();
+
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [&]() { return running == 0; });
+}
+
+// Number of workers
+auto ThreadPool::size() const noexcept -> std::size_t
+{
+    return m_workers.size();
+}
+
+
+// Worker loop
+void ThreadPool::run()
+{
+    while (true)
+    {
+        t_task task;
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+
+            if (m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.back());
+            m_tasks.pop_back();
+        }
+
+        task();
+    }
+}
+
+
+
+// ---------------------------------------------------------------
+// Application theme: skins, fonts, colors, etc
+// Text is laid out and rasterized once: glyphs are cached in an
+// atlas, and shaped text runs in a LRU cache
+// ---------------------------------------------------------------
+// 5x8 bitmap font, printable ASCII (32 to 126)
+// 5 columns per glyph, bit 0 is the top row
+namespace font
+{
+    constexpr std::int32_t GLYPH_WIDTH  = 5;
+    constexpr std::int32_t GLYPH_HEIGHT = 8;
+    // Glyph width + spacing
+    constexpr std::int32_t ADVANCE = 6;
+
+    constexpr char FIRST_CHAR = ' ';
+    constexpr char LAST_CHAR  = '~';
+
+    constexpr std::uint8_t GLYPHS[] =
+    {
+        0x00, 0x00, 0x00, 0x00, 0x00,   0x00, 0x00, 0x5F, 0x00, 0x00,   0x00, 0x07, 0x00, 0x07, 0x00,   0x14, 0x7F, 0x14, 0x7F, 0x14,
+        0x24, 0x2A, 0x7F, 0x2A, 0x12,   0x23, 0x13, 0x08, 0x64, 0x62,   0x36, 0x49, 0x56, 0x20, 0x50,   0x00, 0x08, 0x07, 0x03, 0x00,
+        0x00, 0x1C, 0x22, 0x41, 0x00,   0x00, 0x41, 0x22, 0x1C, 0x00,   0x2A, 0x1C, 0x7F, 0x1C, 0x2A,   0x08, 0x08, 0x3E, 0x08, 0x08,
+        0x00, 0x80, 0x70, 0x30, 0x00,   0x08, 0x08, 0x08, 0x08, 0x08,   0x00, 0x00, 0x60, 0x60, 0x00,   0x20, 0x10, 0x08, 0x04, 0x02,
+        0x3E, 0x51, 0x49, 0x45, 0x3E,   0x00, 0x42, 0x7F, 0x40, 0x00,   0x72, 0x49, 0x49, 0x49, 0x46,   0x21, 0x41, 0x49, 0x4D, 0x33,
+        0x18, 0x14, 0x12, 0x7F, 0x10,   0x27, 0x45, 0x45, 0x45, 0x39,   0x3C, 0x4A, 0x49, 0x49, 0x31,   0x41, 0x21, 0x11, 0x09, 0x07,
+        0x36, 0x49, 0x49, 0x49, 0x36,   0x46, 0x49, 0x49, 0x29, 0x1E,   0x00, 0x00, 0x14, 0x00, 0x00,   0x00, 0x40, 0x34, 0x00, 0x00,
+        0x00, 0x08, 0x14, 0x22, 0x41,   0x14, 0x14, 0x14, 0x14, 0x14,   0x00, 0x41, 0x22, 0x14, 0x08,   0x02, 0x01, 0x59, 0x09, 0x06,
+        0x3E, 0x41, 0x5D, 0x59, 0x4E,   0x7C, 0x12, 0x11, 0x12, 0x7C,   0x7F, 0x49, 0x49, 0x49, 0x36,   0x3E, 0x41, 0x41, 0x41, 0x22,
+        0x7F, 0x41, 0x41, 0x41, 0x3E,   0x7F, 0x49, 0x49, 0x49, 0x41,   0x7F, 0x09, 0x09, 0x09, 0x01,   0x3E, 0x41, 0x41, 0x51, 0x73,
+        0x7F, 0x08, 0x08, 0x08, 0x7F,   0x00, 0x41, 0x7F, 0x41, 0x00,   0x20, 0x40, 0x41, 0x3F, 0x01,   0x7F, 0x08, 0x14, 0x22, 0x41,
+        0x7F, 0x40, 0x40, 0x40, 0x40,   0x7F, 0x02, 0x1C, 0x02, 0x7F,   0x7F, 0x04, 0x08, 0x10, 0x7F,   0x3E, 0x41, 0x41, 0x41, 0x3E,
+        0x7F, 0x09, 0x09, 0x09, 0x06,   0x3E, 0x41, 0x51, 0x21, 0x5E,   0x7F, 0x09, 0x19, 0x29, 0x46,   0x26, 0x49, 0x49, 0x49, 0x32,
+        0x03, 0x01, 0x7F, 0x01, 0x03,   0x3F, 0x40, 0x40, 0x40, 0x3F,   0x1F, 0x20, 0x40, 0x20, 0x1F,   0x3F, 0x40, 0x38, 0x40, 0x3F,
+        0x63, 0x14, 0x08, 0x14, 0x63,   0x03, 0x04, 0x78, 0x04, 0x03,   0x61, 0x59, 0x49, 0x4D, 0x43,   0x00, 0x7F, 0x41, 0x41, 0x41,
+        0x02, 0x04, 0x08, 0x10, 0x20,   0x00, 0x41, 0x41, 0x41, 0x7F,   0x04, 0x02, 0x01, 0x02, 0x04,   0x40, 0x40, 0x40, 0x40, 0x40,
+        0x00, 0x03, 0x07, 0x08, 0x00,   0x20, 0x54, 0x54, 0x78, 0x40,   0x7F, 0x28, 0x44, 0x44, 0x38,   0x38, 0x44, 0x44, 0x44, 0x28,
+        0x38, 0x44, 0x44, 0x28, 0x7F,   0x38, 0x54, 0x54, 0x54, 0x18,   0x00, 0x08, 0x7E, 0x09, 0x02,   0x18, 0xA4, 0xA4, 0x9C, 0x78,
+        0x7F, 0x08, 0x04, 0x04, 0x78,   0x00, 0x44, 0x7D, 0x40, 0x00,   0x20, 0x40, 0x40, 0x3D, 0x00,   0x7F, 0x10, 0x28, 0x44, 0x00,
+        0x00, 0x41, 0x7F, 0x40, 0x00,   0x7C, 0x04, 0x78, 0x04, 0x78,   0x7C, 0x08, 0x04, 0x04, 0x78,   0x38, 0x44, 0x44, 0x44, 0x38,
+        0xFC, 0x18, 0x24, 0x24, 0x18,   0x18, 0x24, 0x24, 0x18, 0xFC,   0x7C, 0x08, 0x04, 0x04, 0x08,   0x48, 0x54, 0x54, 0x54, 0x24,
+        0x04, 0x04, 0x3F, 0x44, 0x24,   0x3C, 0x40, 0x40, 0x20, 0x7C,   0x1C, 0x20, 0x40, 0x20, 0x1C,   0x3C, 0x40, 0x30, 0x40, 0x3C,
+        0x44, 0x28, 0x10, 0x28, 0x44,   0x4C, 0x90, 0x90, 0x90, 0x7C,   0x44, 0x64, 0x54, 0x4C, 0x44,   0x00, 0x08, 0x36, 0x41, 0x00,
+        0x00, 0x00, 0x77, 0x00, 0x00,   0x00, 0x41, 0x36, 0x08, 0x00,   0x02, 0x01, 0x02, 0x04, 0x02,
+    };
+
+    // Columns of a glyph (unknown characters are drawn as '?')
+    inline auto glyph(char character) noexcept -> const std::uint8_t*
+    {
+        if (character < FIRST_CHAR || character > LAST_CHAR)
+            character = '?';
+
+        return GLYPHS + (character - FIRST_CHAR) * GLYPH_WIDTH;
+    }
+}
+
+
+// Glyph bitmaps (8 bit coverage) packed into a single texture,
+// one entry per font, pixel size and character
+class GlyphAtlas
+{
+    public:
+
+        // Where a glyph is inside the atlas
+        struct Glyph
+        {
+            // Empty for blank glyphs (space)
+            Rect<std::int32_t> rect;
+            std::int32_t advance;
+        };
+
+
+    public:
+
+        // The atlas doesn't grow past this height
+        static constexpr std::int32_t MAX_HEIGHT = 4096;
+
+
+    public:
+
+        // ctor
+        explicit GlyphAtlas(std::int32_t width = 512, std::int32_t height = 128);
+
+
+        // Find (or rasterize) a glyph
+        auto getGlyph(std::uint16_t fontId, std::int32_t pixelSize, char character) -> const Glyph&;
+
+        // Coverage of a texel row
+        auto row(std::int32_t y) const noexcept -> const std::uint8_t*;
+
+        // Number of cached glyphs
+        auto size() const noexcept -> std::size_t;
+
+
+    private:
+
+        // Reserve space, packed in horizontal shelves (the atlas grows when full)
+        // Empty if it doesn't fit: the glyph is left blank
+        auto allocate(std::int32_t width, std::int32_t height) -> Rect<std::int32_t>;
+
+        static auto glyphKey(std::uint16_t fontId, std::int32_t pixelSize, char character) noexcept -> std::uint64_t;
+
+
+        // Texture
+        std::int32_t m_width;
+        std::int32_t m_height;
+        std::vector<std::uint8_t> m_texels;
+
+        // Current shelf
+        std::int32_t m_shelfX;
+        std::int32_t m_shelfY;
+        std::int32_t m_shelfHeight;
+
+        // Rasterized glyphs
+        std::unordered_map<std::uint64_t, Glyph> m_glyphs;
+
+};
+
+
+// Text run with every glyph already positioned
+struct ShapedText
+{
+    struct PositionedGlyph
+    {
+        // Relative to the pen origin (top left)
+        std::int32_t x, y;
+        Rect<std::int32_t> atlasRect;
+    };
+
+    std::vector<PositionedGlyph> glyphs;
+
+    std::int32_t width;
+    std::int32_t height;
+};
+
+
+// Shaped text runs by text, font and size
+// The least recently used runs are evicted when it's full
+class TextCache
+{
+    public:
+
+        // Shared, evicting a run still being drawn is safe
+        using t_shapedPtr = std::shared_ptr<const ShapedText>;
+
+
+    public:
+
+        // ctor
+        explicit TextCache(GlyphAtlas& atlas, std::size_t capacity = 1024);
+
+
+        // Find (or shape) a text run
+        auto shape(std::string_view text, std::uint16_t fontId, std::int32_t pixelSize) -> t_shapedPtr;
+
+        // Number of cached runs
+        auto size() const noexcept -> std::size_t;
+
+
+    private:
+
+        // The key views the text stored in its LRU list node
+        struct Key
+        {
+            std::string_view text;
+            std::uint16_t fontId;
+            std::int32_t pixelSize;
+
+            auto operator==(const Key& other) const noexcept -> bool
+            {
+                return fontId == other.fontId && pixelSize == other.pixelSize && text == other.text;
+            }
+        };
+
+        struct KeyHash
+        {
+            auto operator()(const Key& key) const noexcept -> std::size_t
+            {
+                return std::hash<std::string_view>{}(key.text) ^ (static_cast<std::size_t>(key.fontId) << 20) ^
+                       static_cast<std::size_t>(key.pixelSize);
+            }
+        };
+
+        struct Entry
+        {
+            std::string text;
+            std::uint16_t fontId;
+            std::int32_t pixelSize;
+
+            t_shapedPtr shaped;
+        };
+
+        // Most recently used first
+        using t_lruList = std::list<Entry>;
+
+
+        // Glyphs source
+        GlyphAtlas& m_atlas;
+
+        // Maximum number of runs
+        std::size_t m_capacity;
+
+        t_lruList m_lru;
+        std::unordered_map<Key, t_lruList::iterator, KeyHash> m_entries;
+
+};
+
+
+// Read-only file mapped in memory (read into memory where mmap doesn't exist)
+class MappedFile
+{
+    public:
+
+        // ctor
+        MappedFile() = default;
+
+        // dtor
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        auto operator=(const MappedFile&) -> MappedFile& = delete;
+
+
+        // false if it can't be opened
+        auto open(const std::string& path) -> bool;
+
+        // Whole file contents
+        auto getData() const noexcept -> std::string_view;
+
+
+    private:
+
+        // Unmap the previous file
+        void close() noexcept;
+
+
+        const char* m_data = nullptr;
+        std::size_t m_size = 0;
+
+        // Contents of the file if it is not mapped
+        std::vector<char> m_buffer;
+
+};
+
+
+// Decoded RGBA8 image (0xRRGGBBAA pixels)
+struct Image
+{
+    std::int32_t width  = 0;
+    std::int32_t height = 0;
+
+    std::vector<std::uint32_t> pixels;
+};
+
+
+// -------------------------------------------------------------------------
+// Packed asset file: every theme asset (images, fonts, skins) in one file
+//
+// Header:  "UIPK", version, number of assets      (3 x uint32)
+// Table:   name (48 chars), type, offset, size    (one entry per asset)
+// Data:    IMAGE - width, height (uint16), runs of (count uint8, pixel uint32)
+//          BLOB  - raw bytes (fonts, skins: the application reads them)
+// -------------------------------------------------------------------------
+class AssetPack
+{
+    public:
+
+        enum class e_type : std::uint32_t { IMAGE, BLOB };
+
+        // Table entry
+        struct Entry
+        {
+            char name[48];
+            e_type type;
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+        // Asset to write
+        struct Source
+        {
+            std::string name;
+            e_type type;
+            std::vector<std::uint8_t> data;
+        };
+
+        static constexpr std::uint32_t MAGIC   = 0x4B505549;   // "UIPK"
+        static constexpr std::uint32_t VERSION = 1;
+
+
+    public:
+
+        // Map the file and check its table (nothing is decoded)
+        auto open(const std::string& path) -> bool;
+
+        // Table entries
+        auto getEntries() const noexcept -> const std::vector<Entry>&;
+        // Raw (still encoded) asset data
+        auto getData(const Entry& entry) const noexcept -> std::string_view;
+
+
+        // Offline packing tool: write the assets into a pack file
+        static auto write(const std::string& path, const std::vector<Source>& sources) -> bool;
+
+        // IMAGE encoding
+        static auto encodeImage(const Image& image) -> std::vector<std::uint8_t>;
+        static auto decodeImage(std::string_view data) -> Image;
+
+
+    private:
+
+        MappedFile m_file;
+        std::vector<Entry> m_entries;
+
+};
+
+
+// App theme handles skins, fonts, colors, etc
+// (the caches are filled on demand: not thread safe)
+// Assets come from a pack file, decoded in the background the first
+// time they are asked for: until then, callers draw a placeholder
+class AppTheme
+{
+    public:
+
+        // The built-in font
+        static constexpr std::uint16_t DEFAULT_FONT = 0;
+
+        // Called on the dispatcher thread when an asset is ready
+        using t_readySlot = std::function<void()>;
+
+
+    public:
+
+        // ctor
+        AppTheme();
+
+        // dtor (waits for the assets being decoded)
+        ~AppTheme();
+
+        // Shaped text run (cached)
+        auto shapeText(std::string_view text, std::int32_t pixelSize, std::uint16_t fontId = DEFAULT_FONT) const
+            -> TextCache::t_shapedPtr;
+
+        // Rasterized glyphs
+        auto getGlyphAtlas() const noexcept -> const GlyphAtlas&;
+
+
+        // Map a pack file: the assets are decoded on the pool when first asked for,
+        // and onReady is posted to the dispatcher after each one
+        auto loadAssets(const std::string& path, ThreadPool& pool, Dispatcher& dispatcher, t_readySlot&& onReady = {}) -> bool;
+
+        // Decoded image, nullptr while it is not ready (or it doesn't exist)
+        auto getImage(std::string_view name) const -> const Image*;
+
+        // Raw asset bytes (fonts, skins), empty if it doesn't exist
+        auto getAssetData(std::string_view name) const -> std::string_view;
+
+
+    private:
+
+        // Decoding state of a pack asset
+        enum e_assetState : std::uint8_t { NOT_LOADED, LOADING, READY };
+
+        struct AssetSlot
+        {
+            std::atomic<std::uint8_t> state{ NOT_LOADED };
+            Image image;
+        };
+
+        // Table index of an asset (nullptr if not found)
+        auto findAsset(std::string_view name) const -> const AssetPack::Entry*;
+
+
+        // Caches, filled while rendering
+        mutable GlyphAtlas m_glyphAtlas;
+        mutable TextCache m_textCache;
+
+        // Mapped assets and their decoding state (same order as the pack table)
+        AssetPack m_assets;
+        std::unique_ptr<AssetSlot[]> m_assetSlots;
+
+        // Where the decoding happens, and where the ready notifications go
+        // (the posted notifications only hold a weak reference: they are dropped once the theme is destroyed)
+        ThreadPool* m_decodePool = nullptr;
+        Dispatcher* m_dispatcher = nullptr;
+        std::shared_ptr<t_readySlot> m_onReady;
+
+        // Assets being decoded (the dtor waits for them)
+        mutable std::mutex m_pendingMutex;
+        mutable std::condition_variable m_pendingDone;
+        mutable std::size_t m_pending = 0;
+
+};
+
+
+// cpp
+// ctor
+GlyphAtlas::GlyphAtlas(std::int32_t width, std::int32_t height)
+    : m_width(width),
+      m_height(height),
+      m_texels(static_cast<std::size_t>(width) * static_cast<std::size_t>(height), 0),
+
+      m_shelfX(0),
+      m_shelfY(0),
+      m_shelfHeight(0)
+{
+}
+
+
+// Find (or rasterize) a glyph
+auto GlyphAtlas::getGlyph(std::uint16_t fontId, std::int32_t pixelSize, char character) -> const Glyph&
+{
+    const auto key = glyphKey(fontId, pixelSize, character);
+
+    if (const auto found = m_glyphs.find(key); found != m_glyphs.end())
+        return found->second;
+
+    // Only the built-in bitmap font exists, scaled by whole pixels
+    const auto scale   = std::max(1, pixelSize / font::GLYPH_HEIGHT);
+    const auto* columns = font::glyph(character);
+
+    Glyph glyph{ {}, font::ADVANCE * scale };
+
+    if (std::any_of(columns, columns + font::GLYPH_WIDTH, [](std::uint8_t column) { return column != 0; }))
+    {
+        glyph.rect = allocate(font::GLYPH_WIDTH * scale, font::GLYPH_HEIGHT * scale);
+
+        for (std::int32_t y = 0; y < glyph.rect.h; ++y)
+        {
+            auto* texels = m_texels.data() + static_cast<std::size_t>(glyph.rect.y + y) * m_width + glyph.rect.x;
+
+            for (std::int32_t x = 0; x < glyph.rect.w; ++x)
+                texels[x] = ((columns[x / scale] >> (y / scale)) & 1) ? 255 : 0;
+        }
+    }
+
+    return m_glyphs.emplace(key, glyph).first->second;
+}
+
+// Coverage of a texel row
+auto GlyphAtlas::row(std::int32_t y) const noexcept -> const std::uint8_t*
+{
+    return m_texels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(m_width);
+}
+
+// Number of cached glyphs
+auto GlyphAtlas::size() const noexcept -> std::size_t
+{
+    return m_glyphs.size();
+}
+
+
+// Reserve space, packed in horizontal shelves (the atlas grows when full)
+// Empty if it doesn't fit: the glyph is left blank
+auto GlyphAtlas::allocate(std::int32_t width, std::int32_t height) -> Rect<std::int32_t>
+{
+    // 1 texel of padding between glyphs
+    constexpr std::int32_t PADDING = 1;
+
+    const auto maxHeight = std::max(m_height, MAX_HEIGHT);
+
+    // Wider than the atlas, or taller than it can grow
+    if (width + PADDING > m_width || height + PADDING > maxHeight)
+        return {};
+
+    // Start a new shelf
+    if (m_shelfX + width + PADDING > m_width)
+    {
+        m_shelfY += m_shelfHeight;
+        m_shelfX = 0;
+        m_shelfHeight = 0;
+    }
+
+    // Grow downwards, existing glyphs keep their position
+    if (m_shelfY + height + PADDING > maxHeight)
+        return {};
+
+    while (m_shelfY + height + PADDING > m_height)
+    {
+        m_height = std::min(m_height * 2, maxHeight);
+        m_texels.resize(static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height), 0);
+    }
+
+    const Rect<std::int32_t> rect{ m_shelfX, m_shelfY, width, height };
+
+    m_shelfX += width + PADDING;
+    m_shelfHeight = std::max(m_shelfHeight, height + PADDING);
+
+    return rect;
+}
+
+auto GlyphAtlas::glyphKey(std::uint16_t fontId, std::int32_t pixelSize, char character) noexcept -> std::uint64_t
+{
+    return (static_cast<std::uint64_t>(fontId) << 40) |
+           (static_cast<std::uint64_t>(static_cast<std::uint32_t>(pixelSize)) << 8) |
+           static_cast<std::uint8_t>(character);
+}
+
+
+// ctor
+TextCache::TextCache(GlyphAtlas& atlas, std::size_t capacity)
+    : m_atlas(atlas),
+      m_capacity(std::max<std::size_t>(1, capacity))
+{
+}
+
+
+// Find (or shape) a text run
+auto TextCache::shape(std::string_view text, std::uint16_t fontId, std::int32_t pixelSize) -> t_shapedPtr
+{
+    // Cache hit: move it to the front
+    if (const auto found = m_entries.find({ text, fontId, pixelSize }); found != m_entries.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, found->second);
+        return found->second->shaped;
+    }
+
+    // Shape it
+    auto shaped = std::make_shared<ShapedText>();
+    shaped->glyphs.reserve(text.size());
+
+    std::int32_t penX = 0;
+
+    for (const auto character : text)
+    {
+        const auto& glyph = m_atlas.getGlyph(fontId, pixelSize, character);
+
+        if (glyph.rect.w > 0)
+            shaped->glyphs.push_back({ penX, 0, glyph.rect });
+
+        penX += glyph.advance;
+    }
+
+    // The advance includes the spacing after the last glyph
+    const auto scale = std::max(1, pixelSize / font::GLYPH_HEIGHT);
+
+    shaped->width  = std::max(0, penX - scale);
+    shaped->height = font::GLYPH_HEIGHT * scale;
+
+    // Make room, evict the least recently used
+    if (m_lru.size() >= m_capacity)
+    {
+        const auto& last = m_lru.back();
+        m_entries.erase({ last.text, last.fontId, last.pixelSize });
+        m_lru.pop_back();
+    }
+
+    m_lru.push_front({ std::string(text), fontId, pixelSize, std::move(shaped) });
+
+    const auto& entry = m_lru.front();
+    m_entries.emplace(Key{ entry.text, fontId, pixelSize }, m_lru.begin());
+
+    return entry.shaped;
+}
+
+// Number of cached runs
+auto TextCache::size() const noexcept -> std::size_t
+{
+    return m_lru.size();
+}
+
+
+// ctor
+AppTheme::AppTheme()
+    : m_textCache(m_glyphAtlas)
+{
+}
+
+// dtor (waits for the assets being decoded)
+AppTheme::~AppTheme()
+{
+    std::unique_lock lock(m_pendingMutex);
+    m_pendingDone.wait(lock, [this]() { return m_pending == 0; });
+
+    // Notifications not delivered yet won't find it
+    m_onReady.reset();
+}
+
+// Shaped text run (cached)
+auto AppTheme::shapeText(std::string_view text, std::int32_t pixelSize, std::uint16_t fontId) const
+    -> TextCache::t_shapedPtr
+{
+    return m_textCache.shape(text, fontId, pixelSize);
+}
+
+// Rasterized glyphs
+auto AppTheme::getGlyphAtlas() const noexcept -> const GlyphAtlas&
+{
+    return m_glyphAtlas;
+}
+
+
+// Map a pack file: the assets are decoded on the pool when first asked for,
+// and onReady is posted to the dispatcher after each one
+auto AppTheme::loadAssets(const std::string& path, ThreadPool& pool, Dispatcher& dispatcher, t_readySlot&& onReady) -> bool
+{
+    // Only once: decoded images are handed out as pointers
+    if (m_assetSlots || !m_assets.open(path))
+        return false;
+
+    m_assetSlots = std::make_unique<AssetSlot[]>(m_assets.getEntries().size());
+
+    m_decodePool = &pool;
+    m_dispatcher = &dispatcher;
+    if (onReady)
+        m_onReady = std::make_shared<t_readySlot>(std::move(onReady));
+
+    return true;
+}
+
+// Decoded image, nullptr while it is not ready (or it doesn't exist)
+auto AppTheme::getImage(std::string_view name) const -> const Image*
+{
+    const auto* entry = findAsset(name);
+
+    if (!entry || entry->type != AssetPack::e_type::IMAGE)
+        return nullptr;
+
+    auto& slot = m_assetSlots[static_cast<std::size_t>(entry - m_assets.getEntries().data())];
+    auto state = slot.state.load(std::memory_order_acquire);
+
+    if (state == READY)
+        return &slot.image;
+
+    // First request: decode it in the background
+    if (state == NOT_LOADED && slot.state.compare_exchange_strong(state, LOADING, std::memory_order_relaxed))
+    {
+        {
+            std::lock_guard lock(m_pendingMutex);
+            ++m_pending;
+        }
+
+        m_decodePool->submit([this, entry, &slot]()
+        {
+            slot.image = AssetPack::decodeImage(m_assets.getData(*entry));
+            slot.state.store(READY, std::memory_order_release);
+
+            if (m_onReady)
+                m_dispatcher->post([onReady = std::weak_ptr<t_readySlot>(m_onReady)]()
+                {
+                    if (const auto slot = onReady.lock())
+                        (*slot)();
+                });
+
+            std::lock_guard lock(m_pendingMutex);
+            if (--m_pending == 0)
+                m_pendingDone.notify_all();
+        });
+    }
+
+    return nullptr;
+}
+
+// Raw asset bytes (fonts, skins), empty if it doesn't exist
+auto AppTheme::getAssetData(std::string_view name) const -> std::string_view
+{
+    const auto* entry = findAsset(name);
+
+    return entry ? m_assets.getData(*entry) : std::string_view{};
+}
+
+// Table index of an asset (nullptr if not found)
+auto AppTheme::findAsset(std::string_view name) const -> const AssetPack::Entry*
+{
+    if (!m_assetSlots)
+        return nullptr;
+
+    // A theme has a few dozen assets: a linear search is enough
+    for (const auto& entry : m_assets.getEntries())
+        if (name == std::string_view(entry.name, static_cast<std::size_t>(std::find(entry.name, std::end(entry.name), '\0') - entry.name)))
+            return &entry;
+
+    return nullptr;
+}
+
+
+// MappedFile
+// dtor
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+// false if it can't be opened
+auto MappedFile::open(const std::string& path) -> bool
+{
+    close();
+
+#if defined(__unix__) || defined(__APPLE__)
+
+    const auto file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat info{};
+    void* mapped = MAP_FAILED;
+
+    if (::fstat(file, &info) == 0 && info.st_size > 0)
+        mapped = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping stays valid after closing the file
+    ::close(file);
+
+    if (mapped == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<const char*>(mapped);
+    m_size = static_cast<std::size_t>(info.st_size);
+
+    return true;
+
+#else
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+
+    return true;
+
+#endif
+}
+
+// Whole file contents
+auto MappedFile::getData() const noexcept -> std::string_view
+{
+    return { m_data, m_size };
+}
+
+// Unmap the previous file
+void MappedFile::close() noexcept
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (m_data)
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+
+    m_buffer.clear();
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+
+// AssetPack
+// Map the file and check its table (nothing is decoded)
+auto AssetPack::open(const std::string& path) -> bool
+{
+    m_entries.clear();
+
+    if (!m_file.open(path))
+        return false;
+
+    const auto data = m_file.getData();
+    std::uint32_t header[3];
+
+    if (data.size() < sizeof(header))
+        return false;
+
+    std::memcpy(header, data.data(), sizeof(header));
+
+    if (header[0] != MAGIC || header[1] != VERSION ||
+        header[2] > (data.size() - sizeof(header)) / sizeof(Entry))
+        return false;
+
+    m_entries.resize(header[2]);
+    std::memcpy(m_entries.data(), data.data() + sizeof(header), m_entries.size() * sizeof(Entry));
+
+    // Every asset must be inside the file
+    for (const auto& entry : m_entries)
+        if (entry.offset > data.size() || entry.size > data.size() - entry.offset)
+        {
+            m_entries.clear();
+            return false;
+        }
+
+    return true;
+}
+
+// Table entries
+auto AssetPack::getEntries() const noexcept -> const std::vector<Entry>&
+{
+    return m_entries;
+}
+
+// Raw (still encoded) asset data
+auto AssetPack::getData(const Entry& entry) const noexcept -> std::string_view
+{
+    return m_file.getData().substr(entry.offset, entry.size);
+}
+
+
+// Offline packing tool: write the assets into a pack file
+auto AssetPack::write(const std::string& path, const std::vector<Source>& sources) -> bool
+{
+    const std::uint32_t header[3] = { MAGIC, VERSION, static_cast<std::uint32_t>(sources.size()) };
+
+    std::vector<Entry> entries(sources.size());
+    auto offset = static_cast<std::uint32_t>(sizeof(header) + entries.size() * sizeof(Entry));
+
+    for (std::size_t i = 0; i < sources.size(); ++i)
+    {
+        auto& entry = entries[i];
+
+        std::memset(entry.name, 0, sizeof(entry.name));
+        std::memcpy(entry.name, sources[i].name.data(), std::min(sources[i].name.size(), sizeof(entry.name)));
+
+        entry.type   = sources[i].type;
+        entry.offset = offset;
+        entry.size   = static_cast<std::uint32_t>(sources[i].data.size());
+
+        offset += entry.size;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+
+    for (const auto& source : sources)
+        file.write(reinterpret_cast<const char*>(source.data.data()), static_cast<std::streamsize>(source.data.size()));
+
+    return static_cast<bool>(file);
+}
+
+
+// IMAGE encoding
+auto AssetPack::encodeImage(const Image& image) -> std::vector<std::uint8_t>
+{
+    std::vector<std::uint8_t> data(4);
+
+    const auto width  = static_cast<std::uint16_t>(image.width);
+    const auto height = static_cast<std::uint16_t>(image.height);
+
+    std::memcpy(data.data(), &width, 2);
+    std::memcpy(data.data() + 2, &height, 2);
+
+    // Runs of the same pixel (up to 255)
+    for (std::size_t i = 0; i < image.pixels.size(); )
+    {
+        std::uint8_t count = 1;
+
+        while (i + count < image.pixels.size() && count < 255 && image.pixels[i + count] == image.pixels[i])
+            ++count;
+
+        data.push_back(count);
+        data.insert(data.end(), 4, 0);
+        std::memcpy(data.data() + data.size() - 4, &image.pixels[i], 4);
+
+        i += count;
+    }
+
+    return data;
+}
+
+auto AssetPack::decodeImage(std::string_view data) -> Image
+{
+    Image image;
+
+    if (data.size() < 4)
+        return image;
+
+    std::uint16_t width, height;
+    std::memcpy(&width, data.data(), 2);
+    std::memcpy(&height, data.data() + 2, 2);
+
+    image.width  = width;
+    image.height = height;
+    image.pixels.reserve(static_cast<std::size_t>(width) * height);
+
+    // Corrupted runs stop the decoding, missing pixels stay transparent
+    for (std::size_t i = 4; i + 5 <= data.size() && image.pixels.size() < image.pixels.capacity(); i += 5)
+    {
+        std::uint32_t pixel;
+        std::memcpy(&pixel, data.data() + i + 1, 4);
+
+        const auto count = std::min<std::size_t>(static_cast<std::uint8_t>(data[i]), image.pixels.capacity() - image.pixels.size());
+        image.pixels.insert(image.pixels.end(), count, pixel);
+    }
+
+    image.pixels.resize(static_cast<std::size_t>(width) * height, 0);
+
+    return image;
+}
+
+
+
+// ------------------------------------------------------
+// Software rendering backend
+// Rasterizes the draw commands into an RGBA8 framebuffer
+// in memory (headless servers, thumbnails, benchmarks)
+// ------------------------------------------------------
+// 8x8 icons of the ICONS texture (e_icon order), bit 7 is the left column
+namespace icons
+{
+    constexpr std::int32_t SIZE = 8;
+
+    constexpr std::uint8_t BITMAPS[][SIZE] =
+    {
+        // CHECK_MARK
+        { 0b00000000,
+          0b00000001,
+          0b00000011,
+          0b10000110,
+          0b11001100,
+          0b01111000,
+          0b00110000,
+          0b00000000 }
+    };
+
+    // Theme images replacing the bitmaps once decoded (the bitmaps are the placeholders)
+    constexpr const char* NAMES[] =
+    {
+        "icons/check_mark"
+    };
+}
+
+
+// RGBA8 framebuffer (0xRRGGBBAA pixels)
+class Framebuffer
+{
+    public:
+
+        // ctor
+        Framebuffer(std::int32_t width, std::int32_t height);
+
+
+        // Getters:
+        auto getWidth() const noexcept -> std::int32_t;
+        auto getHeight() const noexcept -> std::int32_t;
+        auto getBounds() const noexcept -> Rect<std::int32_t>;
+
+        // First pixel of a row
+        auto row(std::int32_t y) noexcept -> std::uint32_t*;
+        auto row(std::int32_t y) const noexcept -> const std::uint32_t*;
+
+        // Fill everything with a color
+        void clear(std::uint32_t color);
+
+        // Write a binary PPM image (alpha is dropped)
+        auto savePPM(const std::string& path) const -> bool;
+
+
+    private:
+
+        std::int32_t m_width;
+        std::int32_t m_height;
+
+        std::vector<std::uint32_t> m_pixels;
+
+};
+
+
+// cpp
+// ctor
+Framebuffer::Framebuffer(std::int32_t width, std::int32_t height)
+    : m_width(width),
+      m_height(height),
+      m_pixels(static_cast<std::size_t>(width) * static_cast<std::size_t>(height), 0x000000FF)
+{
+}
+
+
+// Getters:
+auto Framebuffer::getWidth() const noexcept -> std::int32_t
+{
+    return m_width;
+}
+
+auto Framebuffer::getHeight() const noexcept -> std::int32_t
+{
+    return m_height;
+}
+
+auto Framebuffer::getBounds() const noexcept -> Rect<std::int32_t>
+{
+    return { 0, 0, m_width, m_height };
+}
+
+
+// First pixel of a row
+auto Framebuffer::row(std::int32_t y) noexcept -> std::uint32_t*
+{
+    return m_pixels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(m_width);
+}
+
+auto Framebuffer::row(std::int32_t y) const noexcept -> const std::uint32_t*
+{
+    return m_pixels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(m_width);
+}
+
+
+// Fill everything with a color
+void Framebuffer::clear(std::uint32_t color)
+{
+    std::fill(m_pixels.begin(), m_pixels.end(), color);
+}
+
+
+// Write a binary PPM image (alpha is dropped)
+auto Framebuffer::savePPM(const std::string& path) const -> bool
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    file << "P6\n" << m_width << ' ' << m_height << "\n255\n";
+
+    for (const auto pixel : m_pixels)
+    {
+        const char rgb[3] = { static_cast<char>(pixel >> 24), static_cast<char>(pixel >> 16), static_cast<char>(pixel >> 8) };
+        file.write(rgb, 3);
+    }
+
+    return static_cast<bool>(file);
+}
+
+
+// Rasterizes on the CPU
+class SoftwareBackend final : public IRenderBackend
+{
+    public:
+
+        // ctor
+        SoftwareBackend(Framebuffer& framebuffer, const AppTheme& theme)
+            : m_framebuffer(framebuffer),
+              m_theme(theme)
+        {
+        }
+
+        void drawBatch(const DrawBatch& batch, const std::vector<DrawCommand>& commands, std::string_view text) override;
+
+
+    private:
+
+        // Render target
+        Framebuffer& m_framebuffer;
+        // Fonts (shaped text cache) and images
+        const AppTheme& m_theme;
+};
+
+// Rasterizes on the CPU, using every core:
+// the commands of a frame are binned into screen tiles, and the tiles are
+// rasterized in parallel (a tile belongs to one thread, pixels need no locks)
+class TiledSoftwareBackend final : public IRenderBackend
+{
+    public:
+
+        // Tile width and height, in pixels
+        static constexpr std::int32_t TILE_SIZE = 64;
+
+
+    public:
+
+        // ctor
+        TiledSoftwareBackend(Framebuffer& framebuffer, ThreadPool& threadPool, const AppTheme& theme);
+
+        // Batches are kept until the end of the frame
+        void drawBatch(const DrawBatch& batch, const std::vector<DrawCommand>& commands, std::string_view text) override;
+
+        // Bin and rasterize the frame
+        void endFrame() override;
+
+
+    private:
+
+        // Render target
+        Framebuffer& m_framebuffer;
+        // Workers
+        ThreadPool& m_threadPool;
+        // Fonts (shaped text cache) and images
+        const AppTheme& m_theme;
+
+        // Commands of the frame, in submission order
+        std::vector<DrawCommand> m_commands;
+        // Shaped text of every text command (null for the others)
+        std::vector<TextCache::t_shapedPtr> m_shapedText;
+        // Theme image of every image command (null for the others, or not decoded yet)
+        std::vector<const Image*> m_images;
+
+        // Command indices overlapping every tile (row major)
+        std::vector<std::vector<std::uint32_t>> m_tiles;
+};
+
+
+// Rasterization functions
+// Everything is clipped to the clip rectangle (the framebuffer, or a part of it)
+namespace raster
+{
+    // Pixel coordinates stay this far from the int32 limits (a width can be added to them)
+    constexpr float MAX_PIXEL = static_cast<float>(1 << 29);
+
+    // Float coordinate to pixel, clamped in float first
+    // (off-screen or animated widgets can be anywhere, NaN gives 0)
+    inline auto toPixel(float value) noexcept -> std::int32_t
+    {
+        return value == value ? static_cast<std::int32_t>(std::clamp(value, -MAX_PIXEL, MAX_PIXEL)) : 0;
+    }
+
+    // Rectangles with a non-finite value draw nothing
+    inline auto isFinite(const Rect<float>& rect) noexcept -> bool
+    {
+        return std::isfinite(rect.x) && std::isfinite(rect.y) && std::isfinite(rect.w) && std::isfinite(rect.h) &&
+               std::isfinite(rect.x + rect.w) && std::isfinite(rect.y + rect.h);
+    }
+
+    // src over dst, 0 <= alpha <= 255 (same math in the SIMD and scalar paths)
+    inline auto blend(std::uint32_t dst, std::uint32_t src, std::uint32_t alpha) noexcept -> std::uint32_t
+    {
+        std::uint32_t result = 0;
+
+        for (std::uint32_t shift = 0; shift < 32; shift += 8)
+        {
+            const auto value = (((dst >> shift) & 0xFFu) * (255u - alpha) + ((src >> shift) & 0xFFu) * alpha) + 128u;
+            result |= (((value + (value >> 8)) >> 8) & 0xFFu) << shift;
+        }
+
+        return result;
+    }
+
+    // Opaque span
+    inline void fillSpan(std::uint32_t* dst, std::size_t count, std::uint32_t color) noexcept
+    {
+        std::size_t i = 0;
+
+#if defined(__SSE2__)
+        const auto pixels = _mm_set1_epi32(static_cast<std::int32_t>(color));
+
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pixels);
+#endif
+
+        for (; i < count; ++i)
+            dst[i] = color;
+    }
+
+    // Translucent span, coverage (0 to 255) multiplies the color alpha
+    inline void blendSpan(std::uint32_t* dst, std::size_t count, std::uint32_t color, std::uint32_t coverage) noexcept
+    {
+        const auto alpha = ((color & 0xFFu) * coverage + 127u) / 255u;
+
+        if (alpha == 0)
+            return;
+
+        if (alpha == 255)
+            return fillSpan(dst, count, color);
+
+        std::size_t i = 0;
+
+#if defined(__SSE2__)
+        // 4 pixels at a time, channels widened to 16 bits
+        const auto zero    = _mm_setzero_si128();
+        const auto inverse = _mm_set1_epi16(static_cast<std::int16_t>(255 - alpha));
+        const auto source  = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32(static_cast<std::int32_t>(color)), zero),
+                                             _mm_set1_epi16(static_cast<std::int16_t>(alpha)));
+        const auto bias    = _mm_set1_epi16(128);
+
+        // (value + 128) / 255, rounded
+        const auto divide = [&](__m128i value)
+        {
+            value = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(value, inverse), source), bias);
+            return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+        };
+
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+
+            const auto low  = divide(_mm_unpacklo_epi8(pixels, zero));
+            const auto high = divide(_mm_unpackhi_epi8(pixels, zero));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+        }
+#endif
+
+        for (; i < count; ++i)
+            dst[i] = blend(dst[i], color, alpha);
+    }
+
+
+    // Filled rectangle with (optionally) rounded corners, anti-aliased edges
+    inline void fillRect(Framebuffer& target, const Rect<std::int32_t>& clip, const Rect<float>& rect,
+                         float radius, std::uint32_t color)
+    {
+        if (!isFinite(rect))
+            return;
+
+        const auto left   = rect.x;
+        const auto right  = rect.x + rect.w;
+        const auto top    = rect.y;
+        const auto bottom = rect.y + rect.h;
+
+        radius = std::clamp(radius, 0.0f, std::min(rect.w, rect.h) * 0.5f);
+
+        const auto y0 = std::max(clip.y, toPixel(std::floor(top)));
+        const auto y1 = std::min(clip.y + clip.h, toPixel(std::ceil(bottom)));
+
+        for (auto y = y0; y < y1; ++y)
+        {
+            // Vertical coverage of this row
+            const auto coverageY = std::min(bottom, y + 1.0f) - std::max(top, static_cast<float>(y));
+            if (coverageY <= 0.0f)
+                continue;
+
+            // Horizontal inset caused by the rounded corners
+            const auto center = y + 0.5f;
+            auto inset = 0.0f;
+
+            if (radius > 0.0f)
+            {
+                const auto dy = std::max({ top + radius - center, center - (bottom - radius), 0.0f });
+                if (dy > 0.0f)
+                    inset = radius - std::sqrt(std::max(0.0f, radius * radius - dy * dy));
+            }
+
+            const auto spanLeft  = left + inset;
+            const auto spanRight = right - inset;
+            if (spanRight <= spanLeft)
+                continue;
+
+            auto* pixels = target.row(y);
+            const auto rowCoverage = static_cast<std::uint32_t>(coverageY * 255.0f + 0.5f);
+
+            // Partially covered pixel
+            const auto edge = [&](std::int32_t x, float coverageX)
+            {
+                if (x >= clip.x && x < clip.x + clip.w)
+                    blendSpan(pixels + x, 1, color, static_cast<std::uint32_t>(coverageX * coverageY * 255.0f + 0.5f));
+            };
+
+            const auto firstFull = toPixel(std::ceil(spanLeft));
+            const auto lastFull  = toPixel(std::floor(spanRight));
+
+            // Both edges inside the same pixel
+            if (lastFull < firstFull)
+            {
+                edge(lastFull, spanRight - spanLeft);
+                continue;
+            }
+
+            if (firstFull > spanLeft)
+                edge(firstFull - 1, firstFull - spanLeft);
+            if (spanRight > lastFull)
+                edge(lastFull, spanRight - lastFull);
+
+            // Fully covered pixels
+            const auto x0 = std::max(clip.x, firstFull);
+            const auto x1 = std::min(clip.x + clip.w, lastFull);
+
+            if (x1 > x0)
+                blendSpan(pixels + x0, static_cast<std::size_t>(x1 - x0), color, rowCoverage);
+        }
+    }
+
+    // Where a text run goes
+    struct TextLayout
+    {
+        // Top left corner and size of a font pixel
+        std::int32_t x, y;
+        std::int32_t scale;
+
+        // Covered area
+        Rect<std::int32_t> bounds;
+    };
+
+    // Text run, centered inside rect (left aligned if rect has no width)
+    inline auto layoutText(const Rect<float>& rect, std::size_t length) noexcept -> TextLayout
+    {
+        // Font pixels are scaled to ~40% of the rectangle height
+        const auto scale = std::max(1, toPixel(rect.h * 0.4f) / font::GLYPH_HEIGHT);
+        const auto width = static_cast<std::int32_t>(std::min<std::int64_t>(
+            static_cast<std::int64_t>(length) * font::ADVANCE * scale - scale, static_cast<std::int64_t>(MAX_PIXEL)));
+
+        const auto x = toPixel(rect.w > 0.0f ? rect.x + (rect.w - static_cast<float>(width)) * 0.5f : rect.x);
+        const auto y = toPixel(rect.y + (rect.h - static_cast<float>((font::GLYPH_HEIGHT - 1) * scale)) * 0.5f);
+
+        return { x, y, scale, { x, y, std::max(0, width), font::GLYPH_HEIGHT * scale } };
+    }
+
+    // Pixels touched by a command
+    inline auto bounds(const DrawCommand& command) noexcept -> Rect<std::int32_t>
+    {
+        if (!isFinite(command.rect))
+            return {};
+
+        if (command.getType() == DrawCommand::e_type::TEXT)
+            return layoutText(command.rect, command.length).bounds;
+
+        const auto x = toPixel(std::floor(command.rect.x));
+        const auto y = toPixel(std::floor(command.rect.y));
+
+        return { x, y,
+                 toPixel(std::ceil(command.rect.x + command.rect.w)) - x,
+                 toPixel(std::ceil(command.rect.y + command.rect.h)) - y };
+    }
+
+    // Shaped text run, glyphs copied from the atlas (see layoutText)
+    inline void drawText(Framebuffer& target, const Rect<std::int32_t>& clip, const TextLayout& layout,
+                         const ShapedText& text, const GlyphAtlas& atlas, std::uint32_t color)
+    {
+        for (const auto& glyph : text.glyphs)
+        {
+            const auto x = layout.x + glyph.x;
+            const auto y = layout.y + glyph.y;
+
+            const auto x0 = std::max(clip.x, x);
+            const auto x1 = std::min(clip.x + clip.w, x + glyph.atlasRect.w);
+            const auto y0 = std::max(clip.y, y);
+            const auto y1 = std::min(clip.y + clip.h, y + glyph.atlasRect.h);
+
+            for (auto row = y0; row < y1; ++row)
+            {
+                const auto* coverage = atlas.row(glyph.atlasRect.y + row - y) + glyph.atlasRect.x - x;
+                auto* pixels = target.row(row);
+
+                // Runs of texels with the same coverage are blended as one span
+                for (auto column = x0; column < x1; )
+                {
+                    const auto value = coverage[column];
+                    const auto start = column;
+
+                    while (column < x1 && coverage[column] == value)
+                        ++column;
+
+                    if (value)
+                        blendSpan(pixels + start, static_cast<std::size_t>(column - start), color, value);
+                }
+            }
+        }
+    }
+
+    // Theme image stretched over the rectangle (nearest sampling)
+    inline void drawImage(Framebuffer& target, const Rect<std::int32_t>& clip, const Rect<float>& rect, const Image& image)
+    {
+        if (image.width <= 0 || image.height <= 0 || !isFinite(rect) || rect.w <= 0.0f || rect.h <= 0.0f)
+            return;
+
+        const auto x0 = std::max(clip.x, toPixel(rect.x));
+        const auto x1 = std::min(clip.x + clip.w, toPixel(rect.x + rect.w));
+        const auto y0 = std::max(clip.y, toPixel(rect.y));
+        const auto y1 = std::min(clip.y + clip.h, toPixel(rect.y + rect.h));
+
+        for (auto y = y0; y < y1; ++y)
+        {
+            const auto sy = std::clamp(static_cast<std::int32_t>((y - rect.y) * image.height / rect.h), 0, image.height - 1);
+            const auto* source = image.pixels.data() + static_cast<std::size_t>(sy) * image.width;
+            auto* pixels = target.row(y);
+
+            for (auto x = x0; x < x1; ++x)
+            {
+                const auto pixel = source[std::clamp(static_cast<std::int32_t>((x - rect.x) * image.width / rect.w), 0, image.width - 1)];
+
+                if (pixel & 0xFFu)
+                    pixels[x] = blend(pixels[x], pixel, pixel & 0xFFu);
+            }
+        }
+    }
+
+    // Icon stretched over the rectangle
+    // (the first pixel may start before a fractional rectangle: samples are clamped)
+    inline void drawIcon(Framebuffer& target, const Rect<std::int32_t>& clip, const Rect<float>& rect,
+                         std::uint32_t icon, std::uint32_t color)
+    {
+        if (icon >= std::size(icons::BITMAPS) || !isFinite(rect) || rect.w <= 0.0f || rect.h <= 0.0f)
+            return;
+
+        const auto& bitmap = icons::BITMAPS[icon];
+
+        const auto x0 = std::max(clip.x, toPixel(rect.x));
+        const auto x1 = std::min(clip.x + clip.w, toPixel(rect.x + rect.w));
+        const auto y0 = std::max(clip.y, toPixel(rect.y));
+        const auto y1 = std::min(clip.y + clip.h, toPixel(rect.y + rect.h));
+
+        for (auto y = y0; y < y1; ++y)
+        {
+            const auto bits = bitmap[std::clamp(static_cast<std::int32_t>((y - rect.y) * icons::SIZE / rect.h), 0, icons::SIZE - 1)];
+            auto* pixels = target.row(y);
+
+            // Nearest sampling, runs of lit pixels as one span
+            for (auto x = x0; x < x1; )
+            {
+                const auto lit = [&](std::int32_t px)
+                {
+                    const auto column = std::clamp(static_cast<std::int32_t>((px - rect.x) * icons::SIZE / rect.w), 0, icons::SIZE - 1);
+                    return ((bits >> (icons::SIZE - 1 - column)) & 1) != 0;
+                };
+
+                if (!lit(x))
+                {
+                    ++x;
+                    continue;
+                }
+
+                const auto start = x;
+                while (x < x1 && lit(x))
+                    ++x;
+
+                blendSpan(pixels + start, static_cast<std::size_t>(x - start), color, 255);
+            }
+        }
+    }
+
+    // Any draw command (text runs must come shaped, icons use the theme image if it is ready)
+    inline void draw(Framebuffer& target, const Rect<std::int32_t>& clip, const DrawCommand& command,
+                     const ShapedText* text, const Image* image, const GlyphAtlas& atlas)
+    {
+        if (!isFinite(command.rect))
+            return;
+
+        switch (command.getType())
+        {
+            case DrawCommand::e_type::QUAD:
+                fillRect(target, clip, command.rect, command.radius, command.color);
+                break;
+
+            case DrawCommand::e_type::TEXT:
+                if (text)
+                    drawText(target, clip, layoutText(command.rect, command.length), *text, atlas, command.color);
+                break;
+
+            case DrawCommand::e_type::IMAGE:
+                if (image)
+                    drawImage(target, clip, command.rect, *image);
+                else
+                    drawIcon(target, clip, command.rect, command.offset, command.color);
+                break;
+        }
+    }
+}
+
+
+// Shaped text run for a text command (the theme caches it)
+auto shapeCommandText(const AppTheme& theme, const DrawCommand& command, std::string_view text) -> TextCache::t_shapedPtr
+{
+    const auto scale = raster::layoutText(command.rect, command.length).scale;
+
+    return theme.shapeText(text.substr(command.offset, command.length), scale * font::GLYPH_HEIGHT);
+}
+
+// Theme image for an image command (nullptr: draw the placeholder bitmap)
+auto commandImage(const AppTheme& theme, const DrawCommand& command) -> const Image*
+{
+    if (command.offset >= std::size(icons::NAMES))
+        return nullptr;
+
+    return theme.getImage(icons::NAMES[command.offset]);
+}
+
+
+// Draws every batch into the framebuffer
+void SoftwareBackend::drawBatch(const DrawBatch& batch, const std::vector<DrawCommand>& commands, std::string_view text)
+{
+    const auto clip = m_framebuffer.getBounds();
+
+    for (auto i = batch.first; i < batch.first + batch.count; ++i)
+    {
+        const auto& command = commands[i];
+
+        if (command.getType() == DrawCommand::e_type::TEXT)
+            raster::draw(m_framebuffer, clip, command, shapeCommandText(m_theme, command, text).get(), nullptr, m_theme.getGlyphAtlas());
+        else if (command.getType() == DrawCommand::e_type::IMAGE)
+            raster::draw(m_framebuffer, clip, command, nullptr, commandImage(m_theme, command), m_theme.getGlyphAtlas());
+        else
+            raster::draw(m_framebuffer, clip, command, nullptr, nullptr, m_theme.getGlyphAtlas());
+    }
+}
+
+
+// ctor
+TiledSoftwareBackend::TiledSoftwareBackend(Framebuffer& framebuffer, ThreadPool& threadPool, const AppTheme& theme)
+    : m_framebuffer(framebuffer),
+      m_threadPool(threadPool),
+      m_theme(theme),
+
+      m_tiles(static_cast<std::size_t>(((framebuffer.getWidth()  + TILE_SIZE - 1) / TILE_SIZE) *
+                                       ((framebuffer.getHeight() + TILE_SIZE - 1) / TILE_SIZE)))
+{
+}
+
+
+// Batches are kept until the end of the frame
+void TiledSoftwareBackend::drawBatch(const DrawBatch& batch, const std::vector<DrawCommand>& commands, std::string_view text)
+{
+    for (auto i = batch.first; i < batch.first + batch.count; ++i)
+    {
+        const auto& command = m_commands.emplace_back(commands[i]);
+
+        // Text is shaped (and images are asked for) here: the tiles only read them
+        if (command.getType() == DrawCommand::e_type::TEXT)
+            m_shapedText.push_back(shapeCommandText(m_theme, command, text));
+        else
+            m_shapedText.emplace_back();
+
+        m_images.push_back(command.getType() == DrawCommand::e_type::IMAGE ? commandImage(m_theme, command) : nullptr);
+    }
+}
+
+// Bin and rasterize the frame
+void TiledSoftwareBackend::endFrame()
+{
+    const auto tilesX = (m_framebuffer.getWidth() + TILE_SIZE - 1) / TILE_SIZE;
+    const auto screen = m_framebuffer.getBounds();
+
+    // Binning, submission order is kept inside every tile
+    for (std::uint32_t i = 0; i < m_commands.size(); ++i)
+    {
+        const auto area = raster::bounds(m_commands[i]);
+        if (!intersects(area, screen))
+            continue;
+
+        const auto x0 = std::max(0, area.x) / TILE_SIZE;
+        const auto y0 = std::max(0, area.y) / TILE_SIZE;
+        const auto x1 = (std::min(screen.w, area.x + area.w) - 1) / TILE_SIZE;
+        const auto y1 = (std::min(screen.h, area.y + area.h) - 1) / TILE_SIZE;
+
+        for (auto ty = y0; ty <= y1; ++ty)
+            for (auto tx = x0; tx <= x1; ++tx)
+                m_tiles[static_cast<std::size_t>(ty * tilesX + tx)].push_back(i);
+    }
+
+    // One task per tile, clipped to it
+    m_threadPool.parallelFor(m_tiles.size(), [&](std::size_t tile)
+    {
+        auto& indices = m_tiles[tile];
+        if (indices.empty())
+            return;
+
+        const auto tx = static_cast<std::int32_t>(tile) % tilesX;
+        const auto ty = static_cast<std::int32_t>(tile) / tilesX;
+
+        const Rect<std::int32_t> clip{ tx * TILE_SIZE, ty * TILE_SIZE,
+                                       std::min(TILE_SIZE, screen.w - tx * TILE_SIZE),
+                                       std::min(TILE_SIZE, screen.h - ty * TILE_SIZE) };
+
+        for (const auto index : indices)
+            raster::draw(m_framebuffer, clip, m_commands[index], m_shapedText[index].get(), m_images[index], m_theme.getGlyphAtlas());
+
+        indices.clear();
+    });
+
+    // Ready for the next frame
+    m_commands.clear();
+    m_shapedText.clear();
+    m_images.clear();
+}
+
+
+
+// ---------------------------------------------------------
+// Spatial index (uniform grid) for widget hit-testing
+// Every cell keeps the widgets overlapping it, so picking
+// only tests the few widgets sharing the cell of the cursor
+// ---------------------------------------------------------
+class SpatialGrid
+{
+    public:
+
+        // ctor
+        explicit SpatialGrid(float cellSize = 64.0f);
+
+
+        // Insert a widget, order decides who is on top (higher wins)
+        void insert(IWidget* widget, std::uint64_t order);
+
+        // Remove a widget that was indexed with the given dimension
+        void remove(IWidget* widget, const Rect<float>& dimension);
+
+        // The widget moved from oldDimension to its current dimension
+        // (only the cells it left or entered change, the others are patched in place)
+        void update(IWidget* widget, const Rect<float>& oldDimension);
+
+        // Topmost visible and active widget under the point
+        // stable (if given) is set to an area around the point where the result stays the same
+        auto pick(const Vec2& point, Rect<float>* stable = nullptr) const -> IWidget*;
+
+        // Every widget overlapping any of the rectangles, appended to result in draw order
+        void query(const std::vector<Rect<float>>& rects, std::vector<IWidget*>& result) const;
+
+
+    private:
+
+        // Widget + draw order
+        struct Entry
+        {
+            IWidget* widget;
+            std::uint64_t order;
+        };
+
+        // Rectangles are packed (one array per component) for the SIMD kernels
+        struct Cell
+        {
+            std::vector<float> x, y, w, h;
+            std::vector<Entry> entries;
+
+            void push(const Entry& entry, const Rect<float>& rect);
+            void erase(std::size_t index);
+            auto find(const IWidget* widget) const noexcept -> std::size_t;
+            auto lanes() const noexcept -> simd::RectLanes;
+        };
+
+        using t_cellKey = std::uint64_t;
+
+        // Widgets covering more cells are kept in a list of their own (tested by every query)
+        static constexpr double MAX_WIDGET_CELLS = 64.0;
+
+
+        // Cells overlapped by a rectangle (inclusive)
+        struct CellRange
+        {
+            std::int32_t x0, y0, x1, y1;
+
+            auto contains(std::int32_t cx, std::int32_t cy) const noexcept -> bool
+            {
+                return cx >= x0 && cx <= x1 && cy >= y0 && cy <= y1;
+            }
+        };
+
+        // Cell coordinates -> key
+        auto cellCoord(float value) const noexcept -> std::int32_t;
+        static auto cellKey(std::int32_t cx, std::int32_t cy) noexcept -> t_cellKey;
+        auto cellRange(const Rect<float>& rect) const noexcept -> CellRange;
+
+        // Calls func(cell key) for every cell overlapped by the rectangle
+        template <typename Func>
+        void forEachCell(const Rect<float>& rect, Func&& func) const;
+
+        // Too big for the cells (or not finite)
+        auto isOversized(const Rect<float>& rect) const noexcept -> bool;
+
+        // Index a widget at this dimension
+        void add(const Entry& entry, const Rect<float>& dimension);
+
+        // Draw order of an indexed widget (false if it isn't)
+        auto findOrder(const IWidget* widget, const Rect<float>& dimension) const noexcept -> std::pair<bool, std::uint64_t>;
+
+
+        // Size of each (square) cell
+        float m_cellSize;
+
+        // Only non-empty cells are stored
+        std::unordered_map<t_cellKey, Cell> m_cells;
+
+        // Widgets covering too many cells, non-finite ones are stored with a NaN rectangle (never found)
+        Cell m_oversized;
+
+        // Kernel results (member to reuse its memory)
+        mutable std::vector<std::uint32_t> m_hits;
+
+};
+
+
+// cpp
+// ctor
+SpatialGrid::SpatialGrid(float cellSize)
+    : m_cellSize(cellSize)
+{
+}
+
+
+// Cell operations
+void SpatialGrid::Cell::push(const Entry& entry, const Rect<float>& rect)
+{
+    x.push_back(rect.x);
+    y.push_back(rect.y);
+    w.push_back(rect.w);
+    h.push_back(rect.h);
+    entries.push_back(entry);
+}
+
+void SpatialGrid::Cell::erase(std::size_t index)
+{
+    // Order inside the cell doesn't matter, swap with the last one
+    x[index] = x.back(); x.pop_back();
+    y[index] = y.back(); y.pop_back();
+    w[index] = w.back(); w.pop_back();
+    h[index] = h.back(); h.pop_back();
+    entries[index] = entries.back(); entries.pop_back();
+}
+
+auto SpatialGrid::Cell::find(const IWidget* widget) const noexcept -> std::size_t
+{
+    for (std::size_t i = 0; i < entries.size(); ++i)
+        if (entries[i].widget == widget)
+            return i;
+
+    return entries.size();
+}
+
+auto SpatialGrid::Cell::lanes() const noexcept -> simd::RectLanes
+{
+    return { x.data(), y.data(), w.data(), h.data(), entries.size() };
+}
+
+
+// Cell coordinates -> key
+auto SpatialGrid::cellCoord(float value) const noexcept -> std::int32_t
+{
+    return static_cast<std::int32_t>(std::floor(value / m_cellSize));
+}
+
+auto SpatialGrid::cellKey(std::int32_t cx, std::int32_t cy) noexcept -> t_cellKey
+{
+    return (static_cast<t_cellKey>(static_cast<std::uint32_t>(cx)) << 32) | static_cast<std::uint32_t>(cy);
+}
+
+// Cells overlapped by a rectangle (inclusive)
+auto SpatialGrid::cellRange(const Rect<float>& rect) const noexcept -> CellRange
+{
+    const auto x0 = cellCoord(rect.x);
+    const auto y0 = cellCoord(rect.y);
+    // Right and bottom edges are exclusive
+    const auto x1 = std::max(x0, cellCoord(std::nextafter(rect.x + rect.w, rect.x)));
+    const auto y1 = std::max(y0, cellCoord(std::nextafter(rect.y + rect.h, rect.y)));
+
+    return { x0, y0, x1, y1 };
+}
+
+// Calls func(cell key) for every cell overlapped by the rectangle
+template <typename Func>
+void SpatialGrid::forEachCell(const Rect<float>& rect, Func&& func) const
+{
+    const auto range = cellRange(rect);
+
+    for (auto cy = range.y0; cy <= range.y1; ++cy)
+        for (auto cx = range.x0; cx <= range.x1; ++cx)
+            func(cellKey(cx, cy));
+}
+
+// Too big for the cells (or not finite)
+auto SpatialGrid::isOversized(const Rect<float>& rect) const noexcept -> bool
+{
+    if (!std::isfinite(rect.x) || !std::isfinite(rect.y) || !std::isfinite(rect.w) || !std::isfinite(rect.h))
+        return true;
+
+    // In double: the cell coordinates of a huge rectangle don't fit an int32
+    const double cellSize = m_cellSize;
+    const auto columns = std::floor((static_cast<double>(rect.x) + rect.w) / cellSize) - std::floor(rect.x / cellSize) + 1.0;
+    const auto rows    = std::floor((static_cast<double>(rect.y) + rect.h) / cellSize) - std::floor(rect.y / cellSize) + 1.0;
+
+    return columns * rows > MAX_WIDGET_CELLS ||
+           std::abs(rect.x) / cellSize > INT32_MAX / 2 || std::abs(rect.y) / cellSize > INT32_MAX / 2;
+}
+
+// Index a widget at this dimension
+void SpatialGrid::add(const Entry& entry, const Rect<float>& dimension)
+{
+    if (!isOversized(dimension))
+    {
+        forEachCell(dimension, [&](t_cellKey key)
+        {
+            m_cells[key].push(entry, dimension);
+        });
+    }
+    else if (std::isfinite(dimension.x + dimension.y + dimension.w + dimension.h))
+        m_oversized.push(entry, dimension);
+    else
+    {
+        // Comparisons with NaN are false: never found
+        constexpr auto NOWHERE = std::numeric_limits<float>::quiet_NaN();
+        m_oversized.push(entry, { NOWHERE, NOWHERE, NOWHERE, NOWHERE });
+    }
+}
+
+// Draw order of an indexed widget (false if it isn't)
+auto SpatialGrid::findOrder(const IWidget* widget, const Rect<float>& dimension) const noexcept -> std::pair<bool, std::uint64_t>
+{
+    if (isOversized(dimension))
+    {
+        const auto index = m_oversized.find(widget);
+
+        if (index < m_oversized.entries.size())
+            return { true, m_oversized.entries[index].order };
+
+        return { false, 0 };
+    }
+
+    // Any of its cells knows it
+    const auto range = cellRange(dimension);
+
+    for (auto cy = range.y0; cy <= range.y1; ++cy)
+        for (auto cx = range.x0; cx <= range.x1; ++cx)
+        {
+            const auto found = m_cells.find(cellKey(cx, cy));
+            if (found == m_cells.end())
+                continue;
+
+            const auto index = found->second.find(widget);
+
+            if (index < found->second.entries.size())
+                return { true, found->second.entries[index].order };
+        }
+
+    return { false, 0 };
+}
+
+
+// Insert a widget, order decides who is on top (higher wins)
+void SpatialGrid::insert(IWidget* widget, std::uint64_t order)
+{
+    add({ widget, order }, widget->getDimension());
+}
+
+// Remove a widget that was indexed with the given dimension
+void SpatialGrid::remove(IWidget* widget, const Rect<float>& dimension)
+{
+    if (isOversized(dimension))
+    {
+        const auto index = m_oversized.find(widget);
+
+        if (index < m_oversized.entries.size())
+            m_oversized.erase(index);
+
+        return;
+    }
+
+    forEachCell(dimension, [&](t_cellKey key)
+    {
+        auto found = m_cells.find(key);
+        if (found == m_cells.end())
+            return;
+
+        auto& cell = found->second;
+        const auto index = cell.find(widget);
+
+        if (index < cell.entries.size())
+            cell.erase(index);
+
+        if (cell.entries.empty())
+            m_cells.erase(found);
+    });
+}
+
+// The widget moved from oldDimension to its current dimension
+// (only the cells it left or entered change, the others are patched in place)
+void SpatialGrid::update(IWidget* widget, const Rect<float>& oldDimension)
+{
+    const auto dimension = widget->getDimension();
+
+    // In or out of the oversized list: indexed again, with the order it had
+    if (isOversized(oldDimension) || isOversized(dimension))
+    {
+        const auto [indexed, order] = findOrder(widget, oldDimension);
+
+        if (indexed)
+            remove(widget, oldDimension);
+
+        add({ widget, order }, dimension);
+        return;
+    }
+
+    const auto oldRange  = cellRange(oldDimension);
+    const auto newRange  = cellRange(dimension);
+
+    // Keep the draw order it had
+    std::uint64_t order = 0;
+    bool indexed = false;
+
+    for (auto cy = oldRange.y0; cy <= oldRange.y1; ++cy)
+        for (auto cx = oldRange.x0; cx <= oldRange.x1; ++cx)
+        {
+            auto found = m_cells.find(cellKey(cx, cy));
+            if (found == m_cells.end())
+                continue;
+
+            auto& cell = found->second;
+            const auto index = cell.find(widget);
+
+            if (index == cell.entries.size())
+                continue;
+
+            order = cell.entries[index].order;
+            indexed = true;
+
+            if (newRange.contains(cx, cy))
+            {
+                cell.x[index] = dimension.x;
+                cell.y[index] = dimension.y;
+                cell.w[index] = dimension.w;
+                cell.h[index] = dimension.h;
+            }
+            else
+            {
+                cell.erase(index);
+
+                if (cell.entries.empty())
+                    m_cells.erase(found);
+            }
+        }
+
+    // Not found where it was: indexed again from scratch
+    if (!indexed)
+    {
+        insert(widget, order);
+        return;
+    }
+
+    // Cells it entered
+    for (auto cy = newRange.y0; cy <= newRange.y1; ++cy)
+        for (auto cx = newRange.x0; cx <= newRange.x1; ++cx)
+            if (!oldRange.contains(cx, cy))
+                m_cells[cellKey(cx, cy)].push({ widget, order }, dimension);
+}
+
+
+// Topmost visible and active widget under the point
+// stable (if given) is set to an area around the point where the result stays the same
+auto SpatialGrid::pick(const Vec2& point, Rect<float>* stable) const -> IWidget*
+{
+    const auto cx = cellCoord(point.x);
+    const auto cy = cellCoord(point.y);
+
+    // Only the widgets of this cell can be found inside it
+    if (stable)
+        *stable = { static_cast<float>(cx) * m_cellSize, static_cast<float>(cy) * m_cellSize, m_cellSize, m_cellSize };
+
+    // The widgets of this cell, and the oversized ones
+    const auto found = m_cells.find(cellKey(cx, cy));
+    const Cell* cells[] = { found != m_cells.end() ? &found->second : nullptr, &m_oversized };
+
+    const Entry* topmost = nullptr;
+    Rect<float> topmostRect;
+
+    for (const auto* cell : cells)
+    {
+        if (!cell)
+            continue;
+
+        m_hits.clear();
+        simd::pointInRects(cell->lanes(), point, m_hits);
+
+        for (const auto index : m_hits)
+        {
+            const auto& entry = cell->entries[index];
+
+            if (entry.widget->isVisible() && entry.widget->isActive() &&
+                (!topmost || entry.order > topmost->order))
+            {
+                topmost = &entry;
+                topmostRect = { cell->x[index], cell->y[index], cell->w[index], cell->h[index] };
+            }
+        }
+    }
+
+    if (stable)
+    {
+        if (topmost)
+            *stable = intersection(*stable, topmostRect);
+
+        // Widgets that would be found if the point moved over them
+        for (const auto* cell : cells)
+        {
+            if (!cell)
+                continue;
+
+            for (std::size_t i = 0; i < cell->entries.size(); ++i)
+            {
+                const auto& entry = cell->entries[i];
+
+                if (&entry != topmost && (!topmost || entry.order > topmost->order) &&
+                    entry.widget->isVisible() && entry.widget->isActive())
+                    *stable = excludeArea(*stable, Rect<float>{ cell->x[i], cell->y[i], cell->w[i], cell->h[i] }, point.x, point.y);
+            }
+        }
+    }
+
+    return topmost ? topmost->widget : nullptr;
+}
+
+// Every widget overlapping any of the rectangles, appended to result in draw order
+void SpatialGrid::query(const std::vector<Rect<float>>& rects, std::vector<IWidget*>& result) const
+{
+    std::vector<Entry> found;
+
+    const auto collect = [&](const Cell& cell, const Rect<float>& rect)
+    {
+        m_hits.clear();
+        simd::rectsOverlap(cell.lanes(), rect, m_hits);
+
+        for (const auto index : m_hits)
+            found.push_back(cell.entries[index]);
+    };
+
+    for (const auto& rect : rects)
+    {
+        collect(m_oversized, rect);
+
+        // Too big to walk its cells: every stored cell is tested
+        if (isOversized(rect))
+        {
+            for (const auto& [key, cell] : m_cells)
+                collect(cell, rect);
+
+            continue;
+        }
+
+        forEachCell(rect, [&](t_cellKey key)
+        {
+            const auto cell = m_cells.find(key);
+
+            if (cell != m_cells.end())
+                collect(cell->second, rect);
+        });
+    }
+
+    // Widgets spanning several cells (or rectangles) are found more than once
+    // (sorted by widget too: the copies are next to each other even if two widgets share an order)
+    std::sort(found.begin(), found.end(), [](const Entry& a, const Entry& b)
+    {
+        return a.order != b.order ? a.order < b.order : std::less<const IWidget*>()(a.widget, b.widget);
+    });
+    found.erase(std::unique(found.begin(), found.end(), [](const Entry& a, const Entry& b) { return a.widget == b.widget; }),
+                found.end());
+
+    for (const auto& entry : found)
+        result.push_back(entry.widget);
+}
+
+
+
+// ------------------------------------------------------------
+// Widget pools: every widget class gets its own contiguous
+// storage, allocated in fixed size chunks so pointers stay valid
+// ------------------------------------------------------------
+class IWidgetPool
+{
+    public:
+
+        // dtor
+        virtual ~IWidgetPool() = default;
+
+        // Number of widgets in the pool
+        virtual auto size() const noexcept -> std::size_t = 0;
+
+        // Destroy the widget at this slot (the slot is reused later)
+        virtual void destroy(std::size_t slot) = 0;
+};
+
+
+template <typename WidgetType, std::size_t ChunkSize = 256>
+class WidgetPool final : public IWidgetPool
+{
+    public:
+
+        // ctor
+        WidgetPool() = default;
+
+        // dtor (destroys every widget)
+        ~WidgetPool() override;
+
+        // Not copyable, widgets can't be copied
+        WidgetPool(const WidgetPool&) = delete;
+        auto operator=(const WidgetPool&) -> WidgetPool& = delete;
+
+
+        // Construct a new widget in place, returns its slot
+        template <typename... Args>
+        auto create(Args&&... args) -> std::size_t;
+
+        // Destroy the widget at this slot (the slot is reused later)
+        void destroy(std::size_t slot) override;
+
+        // Number of widgets in the pool
+        auto size() const noexcept -> std::size_t override;
+
+        // Access by slot
+        auto operator[](std::size_t slot) noexcept -> WidgetType&;
+
+
+    private:
+
+        // Raw storage for ChunkSize widgets
+        struct Chunk
+        {
+            alignas(WidgetType) std::byte storage[sizeof(WidgetType) * ChunkSize];
+        };
+
+
+        std::vector<std::unique_ptr<Chunk>> m_chunks;
+        // Slots used so far (alive or free)
+        std::size_t m_size = 0;
+
+        // Which slots hold a widget, and the destroyed ones to reuse
+        std::vector<bool> m_alive;
+        std::vector<std::size_t> m_freeSlots;
+
+};
+
+
+// Unique index for every widget class (used to find its pool)
+inline auto nextWidgetPoolId() noexcept -> std::size_t
+{
+    static std::size_t counter = 0;
+    return counter++;
+}
+
+template <typename WidgetType>
+auto widgetPoolId() noexcept -> std::size_t
+{
+    static const auto id = nextWidgetPoolId();
+    return id;
+}
+
+
+// --- Template functions implementation ---
+// dtor (destroys every widget)
+template <typename WidgetType, std::size_t ChunkSize>
+WidgetPool<WidgetType, ChunkSize>::~WidgetPool()
+{
+    for (std::size_t slot = 0; slot < m_size; ++slot)
+        if (m_alive[slot])
+            (*this)[slot].~WidgetType();
+}
+
+// Construct a new widget in place, returns its slot
+template <typename WidgetType, std::size_t ChunkSize>
+template <typename... Args>
+auto WidgetPool<WidgetType, ChunkSize>::create(Args&&... args) -> std::size_t
+{
+    std::size_t slot;
+
+    // Reuse a destroyed widget slot first
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        if (m_size == m_chunks.size() * ChunkSize)
+            m_chunks.push_back(std::make_unique<Chunk>());
+
+        slot = m_size++;
+        m_alive.push_back(false);
+    }
+
+    auto* storage = m_chunks[slot / ChunkSize]->storage + (slot % ChunkSize) * sizeof(WidgetType);
+    new (storage) WidgetType(std::forward<Args>(args)...);
+
+    m_alive[slot] = true;
+    return slot;
+}
+
+// Destroy the widget at this slot (the slot is reused later)
+template <typename WidgetType, std::size_t ChunkSize>
+void WidgetPool<WidgetType, ChunkSize>::destroy(std::size_t slot)
+{
+    (*this)[slot].~WidgetType();
+
+    m_alive[slot] = false;
+    m_freeSlots.push_back(slot);
+}
+
+// Number of widgets in the pool
+template <typename WidgetType, std::size_t ChunkSize>
+auto WidgetPool<WidgetType, ChunkSize>::size() const noexcept -> std::size_t
+{
+    return m_size - m_freeSlots.size();
+}
+
+// Access by slot
+template <typename WidgetType, std::size_t ChunkSize>
+auto WidgetPool<WidgetType, ChunkSize>::operator[](std::size_t slot) noexcept -> WidgetType&
+{
+    auto* storage = m_chunks[slot / ChunkSize]->storage + (slot % ChunkSize) * sizeof(WidgetType);
+    return *std::launder(reinterpret_cast<WidgetType*>(storage));
+}
+
+
+
+// ---------------------------------------------------------------------
+// Declarative UI layouts
+// A text description is compiled offline into a binary blob:
+// the UserInterface creates its widgets in one pass, nothing is parsed
+//
+// Text format, one widget per line (indented lines are children):
+//     Panel id=settings rect=50,50,220,120
+//         Checkbox id=vsync rect=20,20,40,40 text="Use VSync" checked
+//
+// Blob: Header, Node[nodeCount] (parents first), text (ids are hashed)
+// ---------------------------------------------------------------------
+namespace layout
+{
+    constexpr std::uint32_t MAGIC   = 0x4C425549;   // "UIBL"
+    constexpr std::uint32_t VERSION = 1;
+
+    // Widget flags
+    enum e_flag : std::uint32_t
+    {
+        CHECKED = 1 << 0,
+        GREYED  = 1 << 1,
+        HIDDEN  = 1 << 2
+    };
+
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t nodeCount;
+        std::uint32_t textSize;
+    };
+
+    struct Node
+    {
+        // Hashed type name (registry key) and id (0 if none)
+        std::uint32_t type;
+        std::uint32_t id;
+
+        // Node index, -1 for roots
+        std::int32_t parent;
+
+        // Relative to the parent
+        float x, y, w, h;
+
+        // Inside the text block
+        std::uint32_t textOffset;
+        std::uint32_t textLength;
+
+        // e_flag bits, and a value for the widget (e.g. button size)
+        std::uint32_t flags;
+        std::uint32_t value;
+    };
+
+
+    // FNV-1a, used for type names and ids
+    constexpr auto hashName(std::string_view name) noexcept -> std::uint32_t
+    {
+        std::uint32_t hash = 2166136261u;
+
+        for (const auto character : name)
+            hash = (hash ^ static_cast<std::uint8_t>(character)) * 16777619u;
+
+        return hash;
+    }
+
+
+    // Widget types registered by every UserInterface
+    inline const std::vector<std::string_view> DEFAULT_TYPES = { "Checkbox", "Button", "Panel" };
+
+
+    // Offline compiler: text description to blob (empty and an error message if invalid)
+    // types: widget type names the layout may use (the ones registered where it is instantiated)
+    auto compile(std::string_view source, std::string* error = nullptr,
+                 const std::vector<std::string_view>& types = DEFAULT_TYPES) -> std::vector<std::uint8_t>;
+}
+
+
+// cpp
+// Offline compiler: text description to blob (empty and an error message if invalid)
+auto layout::compile(std::string_view source, std::string* error, const std::vector<std::string_view>& types) -> std::vector<std::uint8_t>
+{
+    std::vector<Node> nodes;
+    std::string text;
+
+    // Open parents: indentation and node index
+    std::vector<std::pair<std::size_t, std::int32_t>> parents;
+
+    const auto fail = [&](std::size_t line, std::string_view message)
+    {
+        if (error)
+            *error = "line " + std::to_string(line) + ": " + std::string(message);
+
+        return std::vector<std::uint8_t>{};
+    };
+
+    std::size_t lineNumber = 0;
+
+    while (!source.empty())
+    {
+        const auto end = source.find('\n');
+        auto line = source.substr(0, end);
+        source.remove_prefix(end == std::string_view::npos ? source.size() : end + 1);
+        ++lineNumber;
+
+        const auto indent = line.find_first_not_of(" \t\r");
+
+        // Empty lines and comments
+        if (indent == std::string_view::npos || line[indent] == '#')
+            continue;
+
+        line.remove_prefix(indent);
+
+        // Close the parents at the same or a deeper indentation
+        while (!parents.empty() && parents.back().first >= indent)
+            parents.pop_back();
+
+        Node node{};
+        node.parent = parents.empty() ? -1 : parents.back().second;
+
+        // Type name, then key=value attributes
+        bool first = true;
+
+        while (!line.empty())
+        {
+            const auto skip = line.find_first_not_of(" \t\r");
+            if (skip == std::string_view::npos)
+                break;
+
+            line.remove_prefix(skip);
+
+            // Quoted values may contain spaces
+            auto tokenEnd = line.find_first_of(" \t\r");
+            if (const auto quote = line.find('"'); quote != std::string_view::npos && quote < tokenEnd)
+            {
+                const auto closing = line.find('"', quote + 1);
+                if (closing == std::string_view::npos)
+                    return fail(lineNumber, "unterminated string");
+
+                tokenEnd = closing + 1;
+            }
+
+            const auto token = line.substr(0, tokenEnd);
+            line.remove_prefix(tokenEnd == std::string_view::npos ? line.size() : tokenEnd);
+
+            if (first)
+            {
+                if (std::find(types.begin(), types.end(), token) == types.end())
+                    return fail(lineNumber, "unknown widget type '" + std::string(token) + "'");
+
+                node.type = hashName(token);
+                first = false;
+                continue;
+            }
+
+            const auto equal = token.find('=');
+            const auto key   = token.substr(0, equal);
+            auto value = equal == std::string_view::npos ? std::string_view{} : token.substr(equal + 1);
+
+            if (key == "id")
+                node.id = hashName(value);
+            else if (key == "rect")
+            {
+                // Whole token, locale independent
+                const auto* next = value.data();
+                const auto* last = value.data() + value.size();
+                auto valid = true;
+
+                for (auto* field : { &node.x, &node.y, &node.w, &node.h })
+                {
+                    if (field != &node.x)
+                        valid = valid && next != last && *next++ == ',';
+
+                    if (!valid)
+                        break;
+
+                    const auto parsed = std::from_chars(next, last, *field);
+                    valid = parsed.ec == std::errc{};
+                    next  = parsed.ptr;
+                }
+
+                if (!valid || next != last)
+                    return fail(lineNumber, "rect must be x,y,w,h");
+            }
+            else if (key == "text")
+            {
+                if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                    value = value.substr(1, value.size() - 2);
+
+                node.textOffset = static_cast<std::uint32_t>(text.size());
+                node.textLength = static_cast<std::uint32_t>(value.size());
+                text += value;
+            }
+            else if (key == "value")
+            {
+                const auto* last = value.data() + value.size();
+                const auto [next, status] = std::from_chars(value.data(), last, node.value);
+
+                if (status != std::errc{} || next != last)
+                    return fail(lineNumber, "value must be an unsigned integer");
+            }
+            else if (key == "checked")
+                node.flags |= CHECKED;
+            else if (key == "greyed")
+                node.flags |= GREYED;
+            else if (key == "hidden")
+                node.flags |= HIDDEN;
+            else
+                return fail(lineNumber, "unknown attribute '" + std::string(key) + "'");
+        }
+
+        parents.emplace_back(indent, static_cast<std::int32_t>(nodes.size()));
+        nodes.push_back(node);
+    }
+
+    // Header, nodes and text, copied as they are
+    const Header header{ MAGIC, VERSION, static_cast<std::uint32_t>(nodes.size()), static_cast<std::uint32_t>(text.size()) };
+
+    std::vector<std::uint8_t> blob(sizeof(Header) + nodes.size() * sizeof(Node) + text.size());
+
+    std::memcpy(blob.data(), &header, sizeof(Header));
+    std::memcpy(blob.data() + sizeof(Header), nodes.data(), nodes.size() * sizeof(Node));
+    std::memcpy(blob.data() + sizeof(Header) + nodes.size() * sizeof(Node), text.data(), text.size());
+
+    return blob;
+}
+
+
+// Widgets created from a layout blob
+class UiScreen
+{
+    public:
+
+        // Widget with this id (invalid handle if none)
+        auto find(std::string_view id) const noexcept -> WidgetHandle;
+
+        // Every widget, in layout order (parents first)
+        auto getWidgets() const noexcept -> const std::vector<WidgetHandle>&;
+
+        // Top level widgets (removing them removes the whole screen)
+        auto getRoots() const -> std::vector<WidgetHandle>;
+
+
+    private:
+
+        friend class UserInterface;
+
+        // Same order as the layout nodes
+        std::vector<WidgetHandle> m_widgets;
+        std::vector<std::uint32_t> m_ids;
+        std::vector<bool> m_roots;
+
+};
+
+
+// cpp
+// Widget with this id (invalid handle if none)
+auto UiScreen::find(std::string_view id) const noexcept -> WidgetHandle
+{
+    const auto hash = layout::hashName(id);
+
+    for (std::size_t i = 0; i < m_ids.size(); ++i)
+        if (m_ids[i] == hash)
+            return m_widgets[i];
+
+    return {};
+}
+
+// Every widget, in layout order (parents first)
+auto UiScreen::getWidgets() const noexcept -> const std::vector<WidgetHandle>&
+{
+    return m_widgets;
+}
+
+// Top level widgets (removing them removes the whole screen)
+auto UiScreen::getRoots() const -> std::vector<WidgetHandle>
+{
+    std::vector<WidgetHandle> roots;
+
+    for (std::size_t i = 0; i < m_widgets.size(); ++i)
+        if (m_roots[i])
+            roots.push_back(m_widgets[i]);
+
+    return roots;
+}
+
+
+
+#if UI_PROFILING
+
+// -----------------------------------------------------------------
+// Profiler: time, draw commands and vertex data of every widget,
+// rendering and event handling, aggregated per widget type and frame
+// -----------------------------------------------------------------
+class UiProfiler
+{
+    public:
+
+        // Vertex data sent to the GPU: 4 vertices (position, uv, color) per quad
+        static constexpr std::size_t VERTEX_SIZE = 2 * sizeof(float) + 2 * sizeof(float) + sizeof(std::uint32_t);
+        static constexpr std::size_t QUAD_BYTES  = 4 * VERTEX_SIZE;
+
+        using t_clock = std::chrono::steady_clock;
+
+        // Costs of a widget, a widget type or a whole frame
+        struct Stats
+        {
+            // Times rendered / events handled
+            std::uint32_t renders = 0;
+            std::uint32_t events  = 0;
+
+            double renderMicros   = 0.0;
+            double dispatchMicros = 0.0;
+
+            std::uint32_t drawCommands = 0;
+            std::size_t vertexBytes    = 0;
+
+            void add(const Stats& other) noexcept;
+        };
+
+        struct WidgetStats
+        {
+            // Widgets owned by other widgets (list rows) use the handle of
+            // their owner and share one entry per type
+            WidgetHandle handle;
+            e_widgetType type;
+
+            Stats stats;
+        };
+
+        struct FrameStats
+        {
+            std::uint64_t frame = 0;
+
+            // Whole render() and dispatchEvents() calls
+            double renderMicros   = 0.0;
+            double dispatchMicros = 0.0;
+
+            // Sum of every widget
+            Stats total;
+
+            // Widgets not drawn, hidden by opaque widgets above them
+            std::uint32_t culled = 0;
+
+            // Index: e_widgetType
+            std::array<Stats, static_cast<std::size_t>(e_widgetType::COUNT)> types;
+            std::vector<WidgetStats> widgets;
+        };
+
+        // Called with every finished frame
+        using t_frameSlot = std::function<void(const FrameStats& frame)>;
+
+
+    public:
+
+        // Vertex bytes a command becomes (one quad per glyph for text)
+        static auto vertexBytes(const DrawCommand& command) noexcept -> std::size_t;
+
+        // Microseconds since start
+        static auto elapsed(t_clock::time_point start) noexcept -> double;
+
+
+        // Record costs of the current frame
+        void addRender(const IWidget& widget, double micros, std::uint32_t drawCommands, std::size_t vertexBytes);
+        void addDispatch(const IWidget& widget, double micros);
+        void addFrameTimes(double renderMicros, double dispatchMicros) noexcept;
+        void addCulled() noexcept;
+
+        // Aggregate the current frame and start the next one
+        void endFrame();
+
+        // Last finished frame
+        auto getLastFrame() const noexcept -> const FrameStats&;
+
+        // Get every finished frame (e.g. log the ones over budget)
+        void setFrameSlot(t_frameSlot&& slot);
+
+
+    private:
+
+        // Handle + type (a destroyed widget's address can be reused in the same frame, its handle cannot)
+        struct Key
+        {
+            WidgetHandle handle;
+            e_widgetType type;
+
+            auto operator==(const Key& other) const noexcept -> bool
+            {
+                return handle == other.handle && type == other.type;
+            }
+        };
+
+        struct KeyHash
+        {
+            auto operator()(const Key& key) const noexcept -> std::size_t
+            {
+                return std::hash<std::uint64_t>{}((static_cast<std::uint64_t>(key.handle.generation) << 32) | key.handle.index) ^
+                       (static_cast<std::size_t>(key.type) << 24);
+            }
+        };
+
+
+        // Entry of the widget in the current frame
+        auto entry(const IWidget& widget) -> WidgetStats&;
+
+
+        FrameStats m_current;
+        FrameStats m_last;
+
+        // Key -> index in m_current.widgets
+        std::unordered_map<Key, std::size_t, KeyHash> m_widgetIndices;
+
+        t_frameSlot m_frameSlot;
+};
+
+
+// cpp
+void UiProfiler::Stats::add(const Stats& other) noexcept
+{
+    renders        += other.renders;
+    events         += other.events;
+    renderMicros   += other.renderMicros;
+    dispatchMicros += other.dispatchMicros;
+    drawCommands   += other.drawCommands;
+    vertexBytes    += other.vertexBytes;
+}
+
+
+// Vertex bytes a command becomes (one quad per glyph for text)
+auto UiProfiler::vertexBytes(const DrawCommand& command) noexcept -> std::size_t
+{
+    return command.getType() == DrawCommand::e_type::TEXT ? command.length * QUAD_BYTES : QUAD_BYTES;
+}
+
+// Microseconds since start
+auto UiProfiler::elapsed(t_clock::time_point start) noexcept -> double
+{
+    return std::chrono::duration<double, std::micro>(t_clock::now() - start).count();
+}
+
+
+// Record costs of the current frame
+void UiProfiler::addRender(const IWidget& widget, double micros, std::uint32_t drawCommands, std::size_t vertexBytes)
+{
+    auto& stats = entry(widget).stats;
+
+    ++stats.renders;
+    stats.renderMicros += micros;
+    stats.drawCommands += drawCommands;
+    stats.vertexBytes  += vertexBytes;
+}
+
+void UiProfiler::addDispatch(const IWidget& widget, double micros)
+{
+    auto& stats = entry(widget).stats;
+
+    ++stats.events;
+    stats.dispatchMicros += micros;
+}
+
+void UiProfiler::addFrameTimes(double renderMicros, double dispatchMicros) noexcept
+{
+    m_current.renderMicros   += renderMicros;
+    m_current.dispatchMicros += dispatchMicros;
+}
+
+void UiProfiler::addCulled() noexcept
+{
+    ++m_current.culled;
+}
+
+
+// Aggregate the current frame and start the next one
+void UiProfiler::endFrame()
+{
+    for (const auto& widget : m_current.widgets)
+    {
+        m_current.types[static_cast<std::size_t>(widget.type)].add(widget.stats);
+        m_current.total.add(widget.stats);
+    }
+
+    if (m_frameSlot)
+        m_frameSlot(m_current);
+
+    // The old frame memory is reused
+    const auto next = m_current.frame + 1;
+
+    std::swap(m_current, m_last);
+
+    m_current.frame          = next;
+    m_current.renderMicros   = 0.0;
+    m_current.dispatchMicros = 0.0;
+    m_current.total          = {};
+    m_current.culled         = 0;
+    m_current.types.fill({});
+    m_current.widgets.clear();
+
+    m_widgetIndices.clear();
+}
+
+// Last finished frame
+auto UiProfiler::getLastFrame() const noexcept -> const FrameStats&
+{
+    return m_last;
+}
+
+// Get every finished frame (e.g. log the ones over budget)
+void UiProfiler::setFrameSlot(t_frameSlot&& slot)
+{
+    m_frameSlot = std::move(slot);
+}
+
+// Entry of the widget in the current frame
+auto UiProfiler::entry(const IWidget& widget) -> WidgetStats&
+{
+    // Widgets owned by other widgets have no handle: use their owner's
+    auto owner = &widget;
+
+    while (!owner->getHandle().isValid() && owner->getParent())
+        owner = owner->getParent();
+
+    const Key key{ owner->getHandle(), widget.getWidgetType() };
+    const auto [found, added] = m_widgetIndices.emplace(key, m_current.widgets.size());
+
+    if (added)
+        m_current.widgets.push_back({ key.handle, key.type, {} });
+
+    return m_current.widgets[found->second];
+}
+
+#endif
+
+
+
+// -----------------------------------------------------------------
+// Event recording: the events given to the UserInterface, with their
+// time and the frames they were dispatched in, in a compact binary
+// stream (replayed by EventReplay, defined after the UserInterface)
+//
+// Header: MAGIC, VERSION (uint32 each), then records:
+// kind (uint8), microseconds since the previous record (varint), and
+// for events: SDL timestamp delta, position delta from the previous
+// event, then the event fields (zigzag varints)
+// -----------------------------------------------------------------
+namespace eventlog
+{
+    constexpr std::uint32_t MAGIC   = 0x56454955;   // "UIEV"
+    constexpr std::uint32_t VERSION = 1;
+
+    // Record kinds
+    enum class e_record : std::uint8_t
+    {
+        FRAME,          // dispatchEvents() was called
+        MOTION,
+        BUTTON_DOWN,
+        BUTTON_UP,
+        WHEEL
+    };
+
+    // Variable length integers (7 bits per byte)
+    inline void putVarint(std::vector<std::uint8_t>& data, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            data.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+
+        data.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    // Signed values: small magnitudes stay small
+    inline void putSigned(std::vector<std::uint8_t>& data, std::int64_t value)
+    {
+        putVarint(data, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+
+    // false if the data ends before the value
+    inline auto getVarint(std::string_view data, std::size_t& offset, std::uint64_t& value) noexcept -> bool
+    {
+        value = 0;
+
+        for (unsigned shift = 0; offset < data.size() && shift < 64; shift += 7)
+        {
+            const auto byte = static_cast<std::uint8_t>(data[offset++]);
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    inline auto getSigned(std::string_view data, std::size_t& offset, std::int64_t& value) noexcept -> bool
+    {
+        std::uint64_t encoded = 0;
+
+        if (!getVarint(data, offset, encoded))
+            return false;
+
+        value = static_cast<std::int64_t>(encoded >> 1) ^ -static_cast<std::int64_t>(encoded & 1);
+        return true;
+    }
+}
+
+
+class EventRecorder
+{
+    public:
+
+        // ctor (the recording starts now)
+        EventRecorder();
+
+
+        // An event given to UserInterface::processEvent (non mouse events are ignored)
+        void record(const SDL_Event& event);
+
+        // The recorded events are dispatched (UserInterface::dispatchEvents)
+        void endFrame();
+
+        // Recorded stream
+        auto getData() const noexcept -> const std::vector<std::uint8_t>&;
+        // false if the file can't be written
+        auto save(const std::string& path) const -> bool;
+
+        // Start again (empty recording)
+        void clear();
+
+
+    private:
+
+        using t_clock = std::chrono::steady_clock;
+
+        // Record kind and time since the previous record
+        void begin(eventlog::e_record kind);
+        // SDL timestamp and position, as deltas
+        void putEventHeader(std::uint32_t timestamp, std::int32_t x, std::int32_t y);
+
+
+        std::vector<std::uint8_t> m_data;
+
+        // Previous record
+        t_clock::time_point m_last;
+        std::uint32_t m_lastTimestamp = 0;
+        std::int32_t m_lastX = 0, m_lastY = 0;
+
+};
+
+
+// cpp
+// ctor (the recording starts now)
+EventRecorder::EventRecorder()
+{
+    clear();
+}
+
+
+// An event given to UserInterface::processEvent (non mouse events are ignored)
+void EventRecorder::record(const SDL_Event& event)
+{
+    switch (event.type)
+    {
+        case SDL_MOUSEMOTION:
+            begin(eventlog::e_record::MOTION);
+            putEventHeader(event.motion.timestamp, event.motion.x, event.motion.y);
+            eventlog::putSigned(m_data, event.motion.xrel);
+            eventlog::putSigned(m_data, event.motion.yrel);
+            break;
+
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            begin(event.type == SDL_MOUSEBUTTONDOWN ? eventlog::e_record::BUTTON_DOWN : eventlog::e_record::BUTTON_UP);
+            putEventHeader(event.button.timestamp, event.button.x, event.button.y);
+            m_data.push_back(event.button.button);
+            m_data.push_back(event.button.clicks);
+            break;
+
+        case SDL_MOUSEWHEEL:
+            // No position: the last one is kept
+            begin(eventlog::e_record::WHEEL);
+            putEventHeader(event.wheel.timestamp, m_lastX, m_lastY);
+            eventlog::putSigned(m_data, event.wheel.x);
+            eventlog::putSigned(m_data, event.wheel.y);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// The recorded events are dispatched (UserInterface::dispatchEvents)
+void EventRecorder::endFrame()
+{
+    begin(eventlog::e_record::FRAME);
+}
+
+
+// Recorded stream
+auto EventRecorder::getData() const noexcept -> const std::vector<std::uint8_t>&
+{
+    return m_data;
+}
+
+// false if the file can't be written
+auto EventRecorder::save(const std::string& path) const -> bool
+{
+    std::ofstream file(path, std::ios::binary);
+
+    file.write(reinterpret_cast<const char*>(m_data.data()), static_cast<std::streamsize>(m_data.size()));
+
+    return static_cast<bool>(file);
+}
+
+
+// Start again (empty recording)
+void EventRecorder::clear()
+{
+    const std::uint32_t header[2] = { eventlog::MAGIC, eventlog::VERSION };
+
+    m_data.resize(sizeof(header));
+    std::memcpy(m_data.data(), header, sizeof(header));
+
+    m_last = t_clock::now();
+    m_lastTimestamp = 0;
+    m_lastX = m_lastY = 0;
+}
+
+
+// Record kind and time since the previous record
+void EventRecorder::begin(eventlog::e_record kind)
+{
+    const auto now = t_clock::now();
+
+    m_data.push_back(static_cast<std::uint8_t>(kind));
+    eventlog::putVarint(m_data, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - m_last).count()));
+
+    m_last = now;
+}
+
+// SDL timestamp and position, as deltas
+void EventRecorder::putEventHeader(std::uint32_t timestamp, std::int32_t x, std::int32_t y)
+{
+    eventlog::putSigned(m_data, static_cast<std::int64_t>(timestamp) - m_lastTimestamp);
+    eventlog::putSigned(m_data, static_cast<std::int64_t>(x) - m_lastX);
+    eventlog::putSigned(m_data, static_cast<std::int64_t>(y) - m_lastY);
+
+    m_lastTimestamp = timestamp;
+    m_lastX = x;
+    m_lastY = y;
+}
+
+
+
+// -------------------------------------------------
+// Graphical User Interface main class
+// - Widget factory
+// - Owns, updates and renders every active widget
+// -------------------------------------------------
+class UserInterface final : private IWidgetObserver
+{
+    public:
+
+        // Creates a widget from a layout node (text is the node text)
+        using t_factory = InplaceFunction<WidgetHandle(UserInterface& ui, const layout::Node& node, std::string_view text)>;
+
+        // Selection alignment (to the selection bounds)
+        enum class e_align
+        {
+            LEFT,
+            RIGHT,
+            TOP,
+            BOTTOM,
+            CENTER_X,
+            CENTER_Y
+        };
+
+        // Selection distribution axis
+        enum class e_axis
+        {
+            HORIZONTAL,
+            VERTICAL
+        };
+
+        // Stacking layers of the root widgets, drawn (and picked) from bottom to top
+        enum class e_layer : std::uint8_t
+        {
+            BACKGROUND,
+            CONTENT,        // default
+            OVERLAY,
+            MODAL,
+            TOOLTIP
+        };
+
+
+    public:
+
+        // ctor (the example widgets are registered for layouts)
+        UserInterface(RenderUI& renderer, const AppTheme& theme)
+            : m_theme(theme), m_renderer(renderer)
+        {
+            registerDefaultWidgets();
+        }
+
+
+        // Adds a new GUI widget
+        template <typename WidgetType, typename... Args>
+        auto add(Args... args) -> WidgetHandle;
+
+        // Widget behind the handle (nullptr if it was removed or it is another type)
+        template <typename WidgetType = IWidget>
+        auto get(const WidgetHandle& handle) const noexcept -> WidgetType*;
+
+        // Destroys the widget and the children added through this class
+        // (during event dispatch it is delayed until the dispatch ends)
+        void remove(const WidgetHandle& handle);
+
+        // Stacking of the root widgets (children are drawn and picked with their root):
+        // by layer, then by z-order, then the last added or raised widget is on top
+        // A widget getting a new layer or z-order goes on top of the ones already there
+        void setLayer(const WidgetHandle& handle, e_layer layer);
+        void setZOrder(const WidgetHandle& handle, std::int16_t zOrder);
+        // Above / below the widgets with the same layer and z-order
+        void bringToFront(const WidgetHandle& handle);
+        void sendToBack(const WidgetHandle& handle);
+
+        auto getLayer(const WidgetHandle& handle) const noexcept -> e_layer;
+        auto getZOrder(const WidgetHandle& handle) const noexcept -> std::int16_t;
+
+        // Bulk operations on a selection (removed widgets are skipped)
+        // Rectangles are relative to each widget parent: select siblings, not a widget and its parent
+        // They are transformed in one packed pass, the spatial index is patched in place
+        // and the selection bounds (before and after) are marked dirty
+        void moveSelection(const std::vector<WidgetHandle>& selection, const Vec2& offset);
+        // Positions and sizes, around the pivot (factor > 0)
+        void scaleSelection(const std::vector<WidgetHandle>& selection, float factor, const Vec2& pivot);
+        void alignSelection(const std::vector<WidgetHandle>& selection, e_align align);
+        // Same gap between neighbours, the first and last ones stay
+        void distributeSelection(const std::vector<WidgetHandle>& selection, e_axis axis);
+
+        // Other threads post their widget updates here
+        // (run by dispatchEvents(), after the events)
+        auto getDispatcher() noexcept -> Dispatcher&;
+
+        // Every processed event and frame is recorded (nullptr: recording stops)
+        void setEventRecorder(EventRecorder* recorder) noexcept;
+
+        // Queue a system event (consecutive motion/scroll events are coalesced)
+        void processEvent(const SDL_Event& event);
+
+        // Dispatch every queued event to the widgets (once per frame)
+        void dispatchEvents();
+
+        // Renders the widgets inside the dirty regions
+        void render() noexcept;
+
+        // Everything must be drawn again (theme assets changed)
+        void invalidate();
+
+#if UI_PROFILING
+        // Costs of the last frame (a frame ends with every render() call)
+        auto getProfiler() noexcept -> UiProfiler&;
+#endif
+
+        // Topmost widget under the point (nullptr if none)
+        // stable (if given) is set to an area around the point where the result stays the same
+        auto pick(const Vec2& point, Rect<float>* stable = nullptr) const -> IWidget*;
+
+        // Widget type usable in layouts (false if the name is taken)
+        auto registerWidget(std::string_view typeName, t_factory&& factory) -> bool;
+
+        // Create every widget of a compiled layout (empty screen if the blob is invalid)
+        auto instantiate(const std::vector<std::uint8_t>& blob) -> UiScreen;
+
+
+    private:
+
+        // Send one event to the widgets
+        void dispatchEvent(const SDL_Event& event);
+
+        // Keep the spatial index in sync with moving widgets
+        void onWidgetMoved(IWidget& widget, const Rect<float>& oldDimension) override;
+
+        // Mark the widget area as dirty
+        void onWidgetChanged(IWidget& widget) override;
+
+        // Only root widgets are in the spatial index
+        void onWidgetReparented(IWidget& widget, const Rect<float>& oldDimension) override;
+
+        // Collect a widget and its children, front to back
+        // (hidden, transparent or clean subtrees and occluded widgets are skipped)
+        void renderSubtree(const IWidget& widget, float opacity, std::uint8_t layer);
+
+        // Widget to draw, with its draw order, layer and opacity (parents included)
+        struct RenderItem
+        {
+            const IWidget* widget;
+            std::uint32_t order;
+            std::uint8_t layer;
+            float opacity;
+        };
+
+        // One loop per widget class, calling the renderer without virtual calls
+        template <typename... Widgets>
+        void renderByType(WidgetTypeList<Widgets...>);
+
+        // Draw the collected widgets of one class
+        template <typename WidgetType>
+        void renderBucket(std::vector<RenderItem>& bucket);
+
+        // Touches any dirty region?
+        auto isDirty(const Rect<float>& dimension) const noexcept -> bool;
+
+        // Hidden by the occluders inside every dirty region it touches?
+        auto isOccluded(const Rect<float>& dimension) const noexcept -> bool;
+        // Opaque area hiding the widgets collected after it (the biggest ones are kept)
+        void addOccluder(const Rect<float>& area);
+
+        // Occluders tested per widget
+        static constexpr std::size_t MAX_OCCLUDERS = 16;
+
+        // This area must be drawn again
+        void markDirty(const Rect<float>& region);
+
+        // Join overlapping dirty regions
+        void mergeDirtyRegions();
+
+        // More dirty regions than this become their bounding box
+        static constexpr std::size_t MAX_DIRTY_REGIONS = 64;
+
+        // Send mouse over/leave when the hovered widget changes
+        void updateMouseOver(IWidget* widget);
+
+        // Hovered widget under the point (no picking while the point stays in the hover area)
+        void updateHover(const Vec2& point);
+
+        // Destroys a widget and its subtree right now
+        void destroy(IWidget& widget);
+
+        // Root order: layer | z-order | sequence (higher is on top)
+        static auto makeOrder(e_layer layer, std::int16_t zOrder, std::uint64_t sequence) noexcept -> std::uint64_t;
+        static auto getOrderLayer(std::uint64_t order) noexcept -> e_layer;
+        static auto getOrderZ(std::uint64_t order) noexcept -> std::int16_t;
+        // Give a widget a new order (the spatial index only holds roots)
+        void restack(IWidget& widget, std::uint64_t order);
+
+        // Packs the rectangles of the live widgets of a selection (false if none)
+        auto gatherSelection(const std::vector<WidgetHandle>& selection) -> bool;
+        auto getSelectionLanes() noexcept -> simd::MutableRectLanes;
+        auto getSelectionBounds() const noexcept -> Rect<float>;
+        // Writes the packed rectangles back to their widgets
+        void applySelection();
+
+        // Checkbox, Button and Panel (layout::DEFAULT_TYPES)
+        void registerDefaultWidgets();
+
+
+        // Pool for this widget type (created on first use)
+        template <typename WidgetType>
+        auto getPool() -> WidgetPool<WidgetType>&;
+
+
+        // --- Widgets -----------------------------------------------------------
+        // Hot data of every widget (declared first: it must outlive the pools)
+        WidgetStore m_store;
+
+        // Owners of all GUI widgets, one pool per widget class
+        std::vector<std::unique_ptr<IWidgetPool>> m_pools;
+
+        // Slot map: handle index -> widget, with the generation of the widget using it
+        struct Slot
+        {
+            IWidget* widget;
+            std::uint32_t generation;
+            std::size_t poolId;
+            std::size_t poolSlot;
+            // Stacking order (see makeOrder)
+            std::uint64_t order;
+        };
+        std::vector<Slot> m_slots;
+        // Slots without widget, reused first
+        std::vector<std::uint32_t> m_freeSlots;
+
+        // Sequence of the next widget put on top / at the bottom (see makeOrder)
+        std::uint64_t m_frontSequence = std::uint64_t{ 1 } << 39;
+        std::uint64_t m_backSequence  = (std::uint64_t{ 1 } << 39) - 1;
+
+        // Layout widget factories, by hashed type name
+        std::unordered_map<std::uint32_t, t_factory> m_factories;
+
+        // On which element the mouse is over
+        IWidget* m_currentMouseOver = nullptr;
+
+        // Hover tracking: while the scene version doesn't change and the mouse
+        // stays inside the hover area, the hovered widget is the same one
+        Rect<float> m_hoverArea{};
+        std::uint64_t m_hoverVersion = 0;
+        // Bumped by every change that can move, hide, show or remove a widget
+        std::uint64_t m_sceneVersion = 1;
+
+        // Hit-testing acceleration structure
+        SpatialGrid m_spatialIndex;
+
+        // --- Events ------------------------------------------------------------
+        // Events received since the last dispatch
+        std::vector<SDL_Event> m_eventQueue;
+        // Events being dispatched
+        std::vector<SDL_Event> m_dispatchQueue;
+        // Widgets removed while dispatching (the handlers may still use them)
+        std::vector<WidgetHandle> m_pendingRemovals;
+        bool m_dispatching = false;
+
+        // Tasks posted by other threads (and queued slots)
+        Dispatcher m_dispatcher;
+
+        // Where the events are recorded (none by default)
+        EventRecorder* m_recorder = nullptr;
+
+        // --- Selection (members to reuse their memory) ------------------------
+        std::vector<IWidget*> m_selection;
+        std::vector<float> m_selectionX, m_selectionY, m_selectionW, m_selectionH;
+        std::vector<std::uint32_t> m_selectionOrder;
+        // Moved widgets don't mark themselves dirty
+        bool m_bulkMoving = false;
+
+#if UI_PROFILING
+        // --- Profiling ---------------------------------------------------------
+        UiProfiler m_profiler;
+#endif
+
+        // --- Graphics ----------------------------------------------------------
+        // Skin & Theme
+        const AppTheme& m_theme;
+
+        // Widgets renderer
+        RenderUI& m_renderer;
+
+        // Areas that changed since the last render
+        std::vector<Rect<float>> m_dirtyRegions;
+        // Widgets overlapping the dirty regions (member to reuse its memory)
+        std::vector<IWidget*> m_widgetsToRender;
+        // Visible dirty widgets grouped by type, with their draw order
+        std::array<std::vector<RenderItem>, static_cast<std::size_t>(e_widgetType::COUNT)> m_renderBuckets;
+        // Draw order of the next collected widget (counts down, collected front to back)
+        std::uint32_t m_renderOrder = 0;
+        // Opaque areas in front of the next collected widget
+        std::vector<Rect<float>> m_occluders;
+
+};
+
+
+
+// --- Template functions implementation ---
+// Adds a new GUI widget
+//
+// Awesome Variadic Templates article:
+// https://eli.thegreenplace.net/2014/variadic-templates-in-c/
+template <typename WidgetType, typename... Args>
+auto UserInterface::add(Args... args) -> WidgetHandle
+{
+
+    // This WidgetType MUST inherit from IWidget
+    static_assert(std::is_base_of_v<IWidget, WidgetType>, "<WidgetType> MUST inherit from <IWidget>!");
+
+    // Create widget
+    auto& pool = getPool<WidgetType>();
+    const auto poolSlot = pool.create(WidgetInit{ m_theme, m_store }, std::forward<Args>(args)...);
+    WidgetType* widget = &pool[poolSlot];
+
+    // Take a free slot (its generation was bumped when it was freed)
+    WidgetHandle handle;
+
+    if (!m_freeSlots.empty())
+    {
+        handle.index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        handle.index = static_cast<std::uint32_t>(m_slots.size());
+        m_slots.push_back({ nullptr, 0, 0, 0, 0 });
+    }
+
+    auto& slot = m_slots[handle.index];
+    slot.widget   = widget;
+    slot.poolId   = widgetPoolId<WidgetType>();
+    slot.poolSlot = poolSlot;
+    slot.order    = makeOrder(e_layer::CONTENT, 0, m_frontSequence++);
+    handle.generation = slot.generation;
+
+    widget->setHandle(handle);
+
+    // Index it, widgets added later are drawn on top
+    widget->setObserver(this);
+    m_spatialIndex.insert(widget, slot.order);
+    ++m_sceneVersion;
+
+    // It must be drawn
+    markDirty(widget->getDimension());
+
+    return handle;
+
+}
+
+// Widget behind the handle (nullptr if it was removed or it is another type)
+template <typename WidgetType>
+auto UserInterface::get(const WidgetHandle& handle) const noexcept -> WidgetType*
+{
+    if (handle.index >= m_slots.size())
+        return nullptr;
+
+    const auto& slot = m_slots[handle.index];
+
+    if (slot.generation != handle.generation || !slot.widget)
+        return nullptr;
+
+    if constexpr (!std::is_same_v<WidgetType, IWidget>)
+    {
+        if (slot.poolId != widgetPoolId<WidgetType>())
+            return nullptr;
+    }
+
+    return static_cast<WidgetType*>(slot.widget);
+}
+
+// Pool for this widget type (created on first use)
+template <typename WidgetType>
+auto UserInterface::getPool() -> WidgetPool<WidgetType>&
+{
+    const auto id = widgetPoolId<WidgetType>();
+
+    if (id >= m_pools.size())
+        m_pools.resize(id + 1);
+
+    if (!m_pools[id])
+        m_pools[id] = std::make_unique<WidgetPool<WidgetType>>();
+
+    return static_cast<WidgetPool<WidgetType>&>(*m_pools[id]);
+}
+
+// One loop per widget class, calling the renderer without virtual calls
+template <typename... Widgets>
+void UserInterface::renderByType(WidgetTypeList<Widgets...>)
+{
+    (renderBucket<Widgets>(m_renderBuckets[static_cast<std::size_t>(Widgets::TYPE)]), ...);
+}
+
+// Draw the collected widgets of one class
+template <typename WidgetType>
+void UserInterface::renderBucket(std::vector<RenderItem>& bucket)
+{
+    for (const auto& [widget, order, layer, opacity] : bucket)
+    {
+        const auto& concrete = static_cast<const WidgetType&>(*widget);
+        m_renderer.setDrawOrder(order);
+        m_renderer.setWidgetLayer(layer);
+        m_renderer.setOpacity(opacity);
+
+#if UI_PROFILING
+        const auto start = UiProfiler::t_clock::now();
+        const auto& commands = m_renderer.getRecordedFrame().commands;
+        const auto first = commands.size();
+
+        m_renderer.render(concrete);
+
+        // Only this widget (children are measured on their own)
+        const auto micros = UiProfiler::elapsed(start);
+        std::size_t vertexBytes = 0;
+
+        for (auto i = first; i < commands.size(); ++i)
+            vertexBytes += UiProfiler::vertexBytes(commands[i]);
+
+        m_profiler.addRender(concrete, micros, static_cast<std::uint32_t>(commands.size() - first), vertexBytes);
+#else
+        m_renderer.render(concrete);
+#endif
+    }
+
+    // Drawn (not by the virtual fallback)
+    bucket.clear();
+}
+
+
+// cpp
+// Queue a system event (consecutive motion/scroll events are coalesced)
+void UserInterface::processEvent(const SDL_Event& event)
+{
+    // Before coalescing: the replay coalesces them again
+    // (events queued by the widgets are made again by the replay)
+    if (m_recorder && !m_dispatching)
+        m_recorder->record(event);
+
+    if (!m_eventQueue.empty())
+    {
+        auto& last = m_eventQueue.back();
+
+        // Only the final position matters, relative motion is accumulated
+        if (event.type == SDL_MOUSEMOTION && last.type == SDL_MOUSEMOTION)
+        {
+            last.motion.timestamp = event.motion.timestamp;
+            last.motion.x = event.motion.x;
+            last.motion.y = event.motion.y;
+            last.motion.xrel += event.motion.xrel;
+            last.motion.yrel += event.motion.yrel;
+            return;
+        }
+
+        // Scroll amounts are accumulated
+        if (event.type == SDL_MOUSEWHEEL && last.type == SDL_MOUSEWHEEL)
+        {
+            last.wheel.timestamp = event.wheel.timestamp;
+            last.wheel.x += event.wheel.x;
+            last.wheel.y += event.wheel.y;
+            return;
+        }
+    }
+
+    m_eventQueue.push_back(event);
+}
+
+// Dispatch every queued event to the widgets (once per frame)
+void UserInterface::dispatchEvents()
+{
+    if (m_recorder)
+        m_recorder->endFrame();
+
+    // Widgets may queue new events while handling these ones,
+    // those will be dispatched on the next frame
+    std::swap(m_eventQueue, m_dispatchQueue);
+
+#if UI_PROFILING
+    const auto start = UiProfiler::t_clock::now();
+#endif
+
+    m_dispatching = true;
+
+    for (const auto& event : m_dispatchQueue)
+        dispatchEvent(event);
+
+    m_dispatching = false;
+
+    // Keeps its capacity for the next frame
+    m_dispatchQueue.clear();
+
+    // Now no handler is running
+    for (const auto& handle : m_pendingRemovals)
+        remove(handle);
+
+    m_pendingRemovals.clear();
+
+    // Updates from other threads, and slots queued by these events
+    m_dispatcher.processQueued();
+
+#if UI_PROFILING
+    m_profiler.addFrameTimes(0.0, UiProfiler::elapsed(start));
+#endif
+}
+
+// Send one event to the widgets
+void UserInterface::dispatchEvent(const SDL_Event& event)
+{
+#if UI_PROFILING
+    const auto start = UiProfiler::t_clock::now();
+#endif
+
+    // Widget handling the event (removals wait until the dispatch ends, it stays valid)
+    IWidget* target = nullptr;
+
+    switch (event.type)
+    {
+        case SDL_MOUSEMOTION:
+        {
+            updateHover({ static_cast<float>(event.motion.x), static_cast<float>(event.motion.y) });
+
+            if ((target = m_currentMouseOver))
+                target->onMouseMotion(event);
+            break;
+        }
+
+        case SDL_MOUSEBUTTONDOWN:
+        {
+            updateHover({ static_cast<float>(event.button.x), static_cast<float>(event.button.y) });
+
+            if ((target = m_currentMouseOver))
+            {
+                target->onClick(event);
+
+                if (event.button.clicks == 2)
+                    target->onDoubleClick(event);
+            }
+            break;
+        }
+
+        case SDL_MOUSEBUTTONUP:
+        {
+            if ((target = pick({ static_cast<float>(event.button.x), static_cast<float>(event.button.y) })))
+                target->onRelease(event);
+            break;
+        }
+
+        case SDL_MOUSEWHEEL:
+        {
+            // Wheel events have no position, scroll what the mouse is over
+            if ((target = m_currentMouseOver))
+                target->onMouseScroll(event);
+            break;
+        }
+
+        default:
+            break;
+    }
+
+#if UI_PROFILING
+    // Hit-testing included
+    if (target)
+        m_profiler.addDispatch(*target, UiProfiler::elapsed(start));
+#endif
+}
+
+// Renders the widgets inside the dirty regions
+void UserInterface::render() noexcept
+{
+#if UI_PROFILING
+    const auto start = UiProfiler::t_clock::now();
+
+    // The frame ends here, drawn or not
+    struct FrameEnd
+    {
+        UiProfiler& profiler;
+        UiProfiler::t_clock::time_point start;
+
+        ~FrameEnd()
+        {
+            profiler.addFrameTimes(UiProfiler::elapsed(start), 0.0);
+            profiler.endFrame();
+        }
+    } frameEnd{ m_profiler, start };
+#endif
+
+    // Nothing changed
+    if (m_dirtyRegions.empty())
+        return;
+
+    mergeDirtyRegions();
+
+    for (const auto& region : m_dirtyRegions)
+        m_renderer.clear(region);
+
+    // Collect the root widgets touching any dirty region
+    m_widgetsToRender.clear();
+    m_spatialIndex.query(m_dirtyRegions, m_widgetsToRender);
+
+    // Front to back (the draw order counts down): the opaque widgets are
+    // collected before the widgets below them, which are skipped if hidden
+    m_renderOrder = DrawCommand::MAX_SEQUENCE;
+    m_occluders.clear();
+
+    for (auto root = m_widgetsToRender.rbegin(); root != m_widgetsToRender.rend(); ++root)
+    {
+        const auto layer = getOrderLayer(m_slots[(*root)->getHandle().index].order);
+        renderSubtree(**root, 1.0f, static_cast<std::uint8_t>(layer));
+    }
+
+    // Homogeneous loops, the draw order is restored when sorting the commands
+    renderByType(t_widgetTypes{});
+
+    // Classes not in t_widgetTypes (virtual call)
+    for (auto& bucket : m_renderBuckets)
+    {
+        for (const auto& [widget, order, layer, opacity] : bucket)
+        {
+            m_renderer.setDrawOrder(order);
+            m_renderer.setWidgetLayer(layer);
+            m_renderer.setOpacity(opacity);
+            widget->accept(m_renderer);
+        }
+        bucket.clear();
+    }
+
+    // Draw calls are issued here
+    m_renderer.flush();
+
+    m_dirtyRegions.clear();
+}
+
+
+// Collect a widget and its children, front to back
+// (hidden, transparent or clean subtrees and occluded widgets are skipped)
+void UserInterface::renderSubtree(const IWidget& widget, float opacity, std::uint8_t layer)
+{
+    opacity *= widget.getOpacity();
+
+    // Out of draw sequence numbers (DrawCommand::MAX_SEQUENCE widgets in one frame):
+    // the widgets behind are dropped, a wrapped counter would draw them in front
+    if (!widget.isVisible() || opacity <= 0.0f || m_renderOrder == 0)
+        return;
+
+    // Children are drawn after their parent: collected before it
+    const auto& children = widget.getChildren();
+
+    for (auto child = children.rbegin(); child != children.rend(); ++child)
+        if (isDirty((*child)->getDimension()))
+            renderSubtree(**child, opacity, layer);
+
+    // Its children may still be seen
+    if (isOccluded(widget.getDrawnArea()))
+    {
+#if UI_PROFILING
+        m_profiler.addCulled();
+#endif
+        return;
+    }
+
+    m_renderBuckets[static_cast<std::size_t>(widget.getWidgetType())].push_back({ &widget, m_renderOrder--, layer, opacity });
+
+    if (opacity >= 1.0f)
+        addOccluder(widget.getOpaqueArea());
+}
+
+// Touches any dirty region?
+auto UserInterface::isDirty(const Rect<float>& dimension) const noexcept -> bool
+{
+    return std::any_of(m_dirtyRegions.begin(), m_dirtyRegions.end(), [&](const Rect<float>& region)
+    {
+        return intersects(region, dimension);
+    });
+}
+
+// Hidden by the occluders inside every dirty region it touches?
+// (outside of them nothing is drawn)
+auto UserInterface::isOccluded(const Rect<float>& dimension) const noexcept -> bool
+{
+    if (m_occluders.empty())
+        return false;
+
+    bool hidden = false;
+
+    for (const auto& region : m_dirtyRegions)
+    {
+        const auto drawn = intersection(dimension, region);
+
+        if (drawn.w <= 0.0f || drawn.h <= 0.0f)
+            continue;
+
+        const auto covered = std::any_of(m_occluders.begin(), m_occluders.end(), [&](const Rect<float>& occluder)
+        {
+            return covers(occluder, drawn);
+        });
+
+        if (!covered)
+            return false;
+
+        hidden = true;
+    }
+
+    return hidden;
+}
+
+// Opaque area hiding the widgets collected after it (the biggest ones are kept)
+void UserInterface::addOccluder(const Rect<float>& area)
+{
+    if (area.w <= 0.0f || area.h <= 0.0f)
+        return;
+
+    if (m_occluders.size() < MAX_OCCLUDERS)
+    {
+        m_occluders.push_back(area);
+        return;
+    }
+
+    auto smallest = std::min_element(m_occluders.begin(), m_occluders.end(), [](const Rect<float>& a, const Rect<float>& b)
+    {
+        return a.w * a.h < b.w * b.h;
+    });
+
+    if (smallest->w * smallest->h < area.w * area.h)
+        *smallest = area;
+}
+
+
+// Topmost widget under the point (nullptr if none)
+// stable (if given) is set to an area around the point where the result stays the same
+auto UserInterface::pick(const Vec2& point, Rect<float>* stable) const -> IWidget*
+{
+    auto* root = m_spatialIndex.pick(point, stable);
+
+    return root ? root->pickDescendant(point, stable) : nullptr;
+}
+
+
+// Keep the spatial index in sync with moving widgets
+void UserInterface::onWidgetMoved(IWidget& widget, const Rect<float>& oldDimension)
+{
+    ++m_sceneVersion;
+
+    if (!widget.getParent())
+        m_spatialIndex.update(&widget, oldDimension);
+
+    // Bulk operations mark the selection bounds once
+    if (m_bulkMoving)
+        return;
+
+    // Both the old and the new area must be drawn again
+    markDirty(oldDimension);
+    markDirty(widget.getDimension());
+}
+
+// Mark the widget area as dirty
+void UserInterface::onWidgetChanged(IWidget& widget)
+{
+    // Maybe hidden or shown
+    ++m_sceneVersion;
+
+    markDirty(widget.getDimension());
+}
+
+// Only root widgets are in the spatial index
+void UserInterface::onWidgetReparented(IWidget& widget, const Rect<float>& oldDimension)
+{
+    ++m_sceneVersion;
+
+    // The index only holds roots: the new parent finds it
+    m_spatialIndex.remove(&widget, oldDimension);
+
+    markDirty(oldDimension);
+    markDirty(widget.getDimension());
+}
+
+// This area must be drawn again
+void UserInterface::markDirty(const Rect<float>& region)
+{
+    if (region.w <= 0.0f || region.h <= 0.0f)
+        return;
+
+    // Already dirty (the same widget changed twice), or covers older regions:
+    // repeated changes don't count towards the limit
+    if (std::any_of(m_dirtyRegions.begin(), m_dirtyRegions.end(), [&](const Rect<float>& dirty) { return covers(dirty, region); }))
+        return;
+
+    m_dirtyRegions.erase(std::remove_if(m_dirtyRegions.begin(), m_dirtyRegions.end(),
+                                        [&](const Rect<float>& dirty) { return covers(region, dirty); }),
+                         m_dirtyRegions.end());
+
+    // Too many regions (merging them is quadratic): one box around all of them
+    if (m_dirtyRegions.size() >= MAX_DIRTY_REGIONS)
+    {
+        for (const auto& dirty : m_dirtyRegions)
+            m_dirtyRegions.front() = merge(m_dirtyRegions.front(), dirty);
+
+        m_dirtyRegions.resize(1);
+    }
+
+    m_dirtyRegions.push_back(region);
+}
+
+// Join overlapping dirty regions
+void UserInterface::mergeDirtyRegions()
+{
+    // Repeat until no region overlaps another one
+    bool merged = true;
+
+    while (merged)
+    {
+        merged = false;
+
+        for (std::size_t i = 0; i < m_dirtyRegions.size(); ++i)
+        {
+            for (std::size_t j = i + 1; j < m_dirtyRegions.size(); )
+            {
+                if (intersects(m_dirtyRegions[i], m_dirtyRegions[j]))
+                {
+                    m_dirtyRegions[i] = merge(m_dirtyRegions[i], m_dirtyRegions[j]);
+                    m_dirtyRegions[j] = m_dirtyRegions.back();
+                    m_dirtyRegions.pop_back();
+                    merged = true;
+                }
+                else
+                    ++j;
+            }
+        }
+    }
+}
+
+// Destroys the widget and the children added through this class
+// (during event dispatch it is delayed until the dispatch ends)
+void UserInterface::remove(const WidgetHandle& handle)
+{
+    auto* widget = get(handle);
+
+    // Already removed (stale handle)
+    if (!widget)
+        return;
+
+    if (m_dispatching)
+        m_pendingRemovals.push_back(handle);
+    else
+        destroy(*widget);
+}
+
+// Stacking of the root widgets
+void UserInterface::setLayer(const WidgetHandle& handle, e_layer layer)
+{
+    if (auto* widget = get(handle))
+        restack(*widget, makeOrder(layer, getOrderZ(m_slots[handle.index].order), m_frontSequence++));
+}
+
+void UserInterface::setZOrder(const WidgetHandle& handle, std::int16_t zOrder)
+{
+    if (auto* widget = get(handle))
+        restack(*widget, makeOrder(getOrderLayer(m_slots[handle.index].order), zOrder, m_frontSequence++));
+}
+
+// Above / below the widgets with the same layer and z-order
+void UserInterface::bringToFront(const WidgetHandle& handle)
+{
+    if (auto* widget = get(handle))
+    {
+        const auto order = m_slots[handle.index].order;
+        restack(*widget, makeOrder(getOrderLayer(order), getOrderZ(order), m_frontSequence++));
+    }
+}
+
+void UserInterface::sendToBack(const WidgetHandle& handle)
+{
+    if (auto* widget = get(handle))
+    {
+        const auto order = m_slots[handle.index].order;
+        restack(*widget, makeOrder(getOrderLayer(order), getOrderZ(order), m_backSequence--));
+    }
+}
+
+auto UserInterface::getLayer(const WidgetHandle& handle) const noexcept -> e_layer
+{
+    return get(handle) ? getOrderLayer(m_slots[handle.index].order) : e_layer::CONTENT;
+}
+
+auto UserInterface::getZOrder(const WidgetHandle& handle) const noexcept -> std::int16_t
+{
+    return get(handle) ? getOrderZ(m_slots[handle.index].order) : 0;
+}
+
+
+// Root order: layer | z-order | sequence (higher is on top)
+// 8 bits of layer, 16 bits of biased z-order and 40 bits of sequence:
+// the sequence starts in the middle, counting up (to the front) or down (to the back)
+auto UserInterface::makeOrder(e_layer layer, std::int16_t zOrder, std::uint64_t sequence) noexcept -> std::uint64_t
+{
+    const auto z = static_cast<std::uint64_t>(static_cast<std::int32_t>(zOrder) + 0x8000);
+
+    return (static_cast<std::uint64_t>(layer) << 56) | (z << 40) | (sequence & ((std::uint64_t{ 1 } << 40) - 1));
+}
+
+auto UserInterface::getOrderLayer(std::uint64_t order) noexcept -> e_layer
+{
+    return static_cast<e_layer>(order >> 56);
+}
+
+auto UserInterface::getOrderZ(std::uint64_t order) noexcept -> std::int16_t
+{
+    return static_cast<std::int16_t>(static_cast<std::int32_t>((order >> 40) & 0xFFFFu) - 0x8000);
+}
+
+// Give a widget a new order (the spatial index only holds roots)
+void UserInterface::restack(IWidget& widget, std::uint64_t order)
+{
+    m_slots[widget.getHandle().index].order = order;
+
+    // Children follow their root
+    if (widget.getParent())
+        return;
+
+    const auto dimension = widget.getDimension();
+
+    m_spatialIndex.remove(&widget, dimension);
+    m_spatialIndex.insert(&widget, order);
+    ++m_sceneVersion;
+
+    markDirty(dimension);
+}
+
+
+// Widget type usable in layouts (false if the name is taken)
+auto UserInterface::registerWidget(std::string_view typeName, t_factory&& factory) -> bool
+{
+    return m_factories.emplace(layout::hashName(typeName), std::move(factory)).second;
+}
+
+// Create every widget of a compiled layout (empty screen if the blob is invalid)
+auto UserInterface::instantiate(const std::vector<std::uint8_t>& blob) -> UiScreen
+{
+    UiScreen screen;
+    layout::Header header;
+
+    if (blob.size() < sizeof(header))
+        return screen;
+
+    std::memcpy(&header, blob.data(), sizeof(header));
+
+    const auto* nodes = blob.data() + sizeof(header);
+    const auto* text  = reinterpret_cast<const char*>(nodes + static_cast<std::size_t>(header.nodeCount) * sizeof(layout::Node));
+
+    if (header.magic != layout::MAGIC || header.version != layout::VERSION ||
+        header.nodeCount > (blob.size() - sizeof(header)) / sizeof(layout::Node) ||
+        blob.size() - sizeof(header) - header.nodeCount * sizeof(layout::Node) != header.textSize)
+        return screen;
+
+    screen.m_widgets.reserve(header.nodeCount);
+    screen.m_ids.reserve(header.nodeCount);
+    screen.m_roots.reserve(header.nodeCount);
+
+    // Parents come first: they already exist when their children are created
+    for (std::uint32_t i = 0; i < header.nodeCount; ++i)
+    {
+        layout::Node node;
+        std::memcpy(&node, nodes + i * sizeof(layout::Node), sizeof(node));
+
+        WidgetHandle handle;
+
+        const auto factory = m_factories.find(node.type);
+        const auto textValid = node.textOffset <= header.textSize && node.textLength <= header.textSize - node.textOffset;
+
+        if (factory != m_factories.end() && textValid)
+            handle = factory->second(*this, node, std::string_view(text + node.textOffset, node.textLength));
+
+        if (auto* widget = get(handle))
+        {
+            if (node.flags & layout::HIDDEN)
+                widget->setVisibility(false);
+
+            if (node.parent >= 0 && static_cast<std::uint32_t>(node.parent) < i)
+                if (auto* parent = get(screen.m_widgets[static_cast<std::size_t>(node.parent)]))
+                    parent->addChildren(widget);
+        }
+
+        // Unknown types leave an invalid handle (their children become roots)
+        screen.m_widgets.push_back(handle);
+        screen.m_ids.push_back(node.id);
+        screen.m_roots.push_back(get(handle) && !get(handle)->getParent());
+    }
+
+    return screen;
+}
+
+// Checkbox, Button and Panel (layout::DEFAULT_TYPES)
+void UserInterface::registerDefaultWidgets()
+{
+    registerWidget("Checkbox", [](UserInterface& ui, const layout::Node& node, std::string_view text)
+    {
+        return ui.add<Checkbox>(Rect<float>{ node.x, node.y, node.w, node.h }, std::string(text),
+                                (node.flags & layout::CHECKED) != 0, (node.flags & layout::GREYED) != 0);
+    });
+
+    // Connect the clicked signal after creating it (find it by id)
+    registerWidget("Button", [](UserInterface& ui, const layout::Node& node, std::string_view text)
+    {
+        return ui.add<Button>(Rect<float>{ node.x, node.y, node.w, node.h }, text, Button::t_slot{},
+                              static_cast<Button::e_buttonSize>(std::min<std::uint32_t>(node.value, 2)));
+    });
+
+    registerWidget("Panel", [](UserInterface& ui, const layout::Node& node, std::string_view)
+    {
+        return ui.add<Panel>(Rect<float>{ node.x, node.y, node.w, node.h });
+    });
+}
+
+#if UI_PROFILING
+// Costs of the last frame (a frame ends with every render() call)
+auto UserInterface::getProfiler() noexcept -> UiProfiler&
+{
+    return m_profiler;
+}
+#endif
+
+// Everything must be drawn again (theme assets changed)
+void UserInterface::invalidate()
+{
+    for (const auto& slot : m_slots)
+        if (slot.widget && !slot.widget->getParent())
+            markDirty(slot.widget->getDimension());
+}
+
+// Bulk operations on a selection (removed widgets are skipped)
+void UserInterface::moveSelection(const std::vector<WidgetHandle>& selection, const Vec2& offset)
+{
+    if (!gatherSelection(selection))
+        return;
+
+    simd::RectTransform transform;
+    transform.tx = offset.x;
+    transform.ty = offset.y;
+
+    simd::transformRects(getSelectionLanes(), transform);
+    applySelection();
+}
+
+// Positions and sizes, around the pivot (factor > 0)
+void UserInterface::scaleSelection(const std::vector<WidgetHandle>& selection, float factor, const Vec2& pivot)
+{
+    if (!gatherSelection(selection))
+        return;
+
+    simd::RectTransform transform;
+    transform.sx = transform.sy = transform.sw = transform.sh = factor;
+    transform.tx = pivot.x * (1.0f - factor);
+    transform.ty = pivot.y * (1.0f - factor);
+
+    simd::transformRects(getSelectionLanes(), transform);
+    applySelection();
+}
+
+void UserInterface::alignSelection(const std::vector<WidgetHandle>& selection, e_align align)
+{
+    if (!gatherSelection(selection))
+        return;
+
+    const auto bounds = getSelectionBounds();
+
+    // The position becomes an edge (or the center), minus the size if needed
+    simd::RectTransform transform;
+
+    switch (align)
+    {
+        case e_align::LEFT:     transform.sx = 0.0f;                        transform.tx = bounds.x;                   break;
+        case e_align::RIGHT:    transform.sx = 0.0f; transform.kx = -1.0f;  transform.tx = bounds.x + bounds.w;        break;
+        case e_align::CENTER_X: transform.sx = 0.0f; transform.kx = -0.5f;  transform.tx = bounds.x + bounds.w * 0.5f; break;
+        case e_align::TOP:      transform.sy = 0.0f;                        transform.ty = bounds.y;                   break;
+        case e_align::BOTTOM:   transform.sy = 0.0f; transform.ky = -1.0f;  transform.ty = bounds.y + bounds.h;        break;
+        case e_align::CENTER_Y: transform.sy = 0.0f; transform.ky = -0.5f;  transform.ty = bounds.y + bounds.h * 0.5f; break;
+    }
+
+    simd::transformRects(getSelectionLanes(), transform);
+    applySelection();
+}
+
+// Same gap between neighbours, the first and last ones stay
+void UserInterface::distributeSelection(const std::vector<WidgetHandle>& selection, e_axis axis)
+{
+    if (!gatherSelection(selection) || m_selection.size() < 3)
+        return;
+
+    auto& position = axis == e_axis::HORIZONTAL ? m_selectionX : m_selectionY;
+    const auto& size = axis == e_axis::HORIZONTAL ? m_selectionW : m_selectionH;
+
+    // Neighbours by position
+    m_selectionOrder.resize(m_selection.size());
+    std::iota(m_selectionOrder.begin(), m_selectionOrder.end(), 0u);
+    std::sort(m_selectionOrder.begin(), m_selectionOrder.end(), [&](std::uint32_t a, std::uint32_t b)
+    {
+        return position[a] < position[b];
+    });
+
+    const auto first = m_selectionOrder.front();
+    const auto last  = m_selectionOrder.back();
+
+    float sizes = 0.0f;
+    for (const auto index : m_selectionOrder)
+        sizes += size[index];
+
+    const auto gap = (position[last] + size[last] - position[first] - sizes) / static_cast<float>(m_selectionOrder.size() - 1);
+    auto next = position[first];
+
+    for (const auto index : m_selectionOrder)
+    {
+        position[index] = next;
+        next += size[index] + gap;
+    }
+
+    applySelection();
+}
+
+
+// Packs the rectangles of the live widgets of a selection (false if none)
+auto UserInterface::gatherSelection(const std::vector<WidgetHandle>& selection) -> bool
+{
+    m_selection.clear();
+    m_selectionX.clear();
+    m_selectionY.clear();
+    m_selectionW.clear();
+    m_selectionH.clear();
+
+    for (const auto& handle : selection)
+    {
+        auto* widget = get(handle);
+        if (!widget)
+            continue;
+
+        const auto local = widget->getLocalDimension();
+
+        m_selection.push_back(widget);
+        m_selectionX.push_back(local.x);
+        m_selectionY.push_back(local.y);
+        m_selectionW.push_back(local.w);
+        m_selectionH.push_back(local.h);
+    }
+
+    return !m_selection.empty();
+}
+
+auto UserInterface::getSelectionLanes() noexcept -> simd::MutableRectLanes
+{
+    return { m_selectionX.data(), m_selectionY.data(), m_selectionW.data(), m_selectionH.data(), m_selection.size() };
+}
+
+auto UserInterface::getSelectionBounds() const noexcept -> Rect<float>
+{
+    auto left   = m_selectionX[0];
+    auto top    = m_selectionY[0];
+    auto right  = left + m_selectionW[0];
+    auto bottom = top + m_selectionH[0];
+
+    for (std::size_t i = 1; i < m_selection.size(); ++i)
+    {
+        left   = std::min(left, m_selectionX[i]);
+        top    = std::min(top, m_selectionY[i]);
+        right  = std::max(right, m_selectionX[i] + m_selectionW[i]);
+        bottom = std::max(bottom, m_selectionY[i] + m_selectionH[i]);
+    }
+
+    return { left, top, right - left, bottom - top };
+}
+
+// Writes the packed rectangles back to their widgets
+void UserInterface::applySelection()
+{
+    auto before = m_selection.front()->getDimension();
+    auto after  = Rect<float>{};
+
+    m_bulkMoving = true;
+
+    for (std::size_t i = 0; i < m_selection.size(); ++i)
+    {
+        auto* widget = m_selection[i];
+
+        before = merge(before, widget->getDimension());
+        widget->setLocalDimension({ m_selectionX[i], m_selectionY[i], m_selectionW[i], m_selectionH[i] });
+        after = i ? merge(after, widget->getDimension()) : widget->getDimension();
+    }
+
+    m_bulkMoving = false;
+
+    markDirty(before);
+    markDirty(after);
+}
+
+
+// Other threads post their widget updates here
+// (run by dispatchEvents(), after the events)
+auto UserInterface::getDispatcher() noexcept -> Dispatcher&
+{
+    return m_dispatcher;
+}
+
+// Every processed event and frame is recorded (nullptr: recording stops)
+void UserInterface::setEventRecorder(EventRecorder* recorder) noexcept
+{
+    m_recorder = recorder;
+}
+
+// Destroys a widget and its subtree right now
+void UserInterface::destroy(IWidget& widget)
+{
+    // Children with a handle are ours, the rest belong to the widget itself
+    const auto children = widget.getChildren();
+
+    for (auto* child : children)
+        if (child->getHandle().isValid())
+            destroy(*child);
+
+    ++m_sceneVersion;
+
+    // Forget the hovered widget if it is in this subtree
+    for (auto* hovered = m_currentMouseOver; hovered; hovered = hovered->getParent())
+        if (hovered == &widget)
+        {
+            m_currentMouseOver = nullptr;
+            break;
+        }
+
+    const auto dimension = widget.getDimension();
+
+    if (!widget.getParent())
+        m_spatialIndex.remove(&widget, dimension);
+
+    if (widget.isVisible())
+        markDirty(dimension);
+
+    // Free the slot, a new generation makes the old handles stale
+    const auto index = widget.getHandle().index;
+    auto& slot = m_slots[index];
+
+    m_pools[slot.poolId]->destroy(slot.poolSlot);
+
+    slot.widget = nullptr;
+    ++slot.generation;
+    m_freeSlots.push_back(index);
+}
+
+// Send mouse over/leave when the hovered widget changes
+void UserInterface::updateMouseOver(IWidget* widget)
+{
+    if (widget == m_currentMouseOver)
+        return;
+
+    if (m_currentMouseOver)
+        m_currentMouseOver->onMouseLeave();
+
+    m_currentMouseOver = widget;
+
+    if (m_currentMouseOver)
+        m_currentMouseOver->onMouseOver();
+}
+
+// Hovered widget under the point (no picking while the point stays in the hover area)
+void UserInterface::updateHover(const Vec2& point)
+{
+    // Same widget: nothing to send
+    if (m_hoverVersion == m_sceneVersion && contains(m_hoverArea, point.x, point.y))
+        return;
+
+    auto* widget = pick(point, &m_hoverArea);
+    m_hoverVersion = m_sceneVersion;
+
+    updateMouseOver(widget);
+}
+
+
+// -----------------------------------------------------------------
+// Animations: tweens of widget position, size and opacity
+// Every running tween lives in packed arrays (one per component),
+// advanced by a SIMD kernel each frame, then applied to the widgets
+// (moving, resizing or fading a widget marks it dirty)
+// -----------------------------------------------------------------
+class Animator
+{
+    public:
+
+        // Animated widget property
+        enum class e_property : std::uint8_t
+        {
+            POSITION,   // relative to the parent (moveTo)
+            SIZE,       // resizeTo
+            OPACITY     // setOpacity (first component)
+        };
+
+        // Easing curves (cubic polynomials, so every tween runs the same code)
+        enum class e_easing : std::uint8_t
+        {
+            LINEAR,
+            EASE_IN,            // quadratic
+            EASE_OUT,           // quadratic
+            EASE_IN_OUT,        // smoothstep
+            EASE_OUT_CUBIC
+        };
+
+        // Called once when a tween ends (not if it is stopped or its widget removed)
+        using t_finished = InplaceFunction<void()>;
+
+
+    public:
+
+        // ctor
+        explicit Animator(UserInterface& ui);
+
+
+        // Animate a property from its current value (a running tween of the same property is replaced)
+        // delay: seconds before it starts
+        void animate(const WidgetHandle& widget, e_property property, const Vec2& target, float duration,
+                     e_easing easing = e_easing::EASE_IN_OUT, float delay = 0.0f, t_finished&& finished = {});
+
+        // Shortcuts
+        void moveTo(const WidgetHandle& widget, const Vec2& position, float duration, e_easing easing = e_easing::EASE_IN_OUT);
+        void resizeTo(const WidgetHandle& widget, const Vec2& size, float duration, e_easing easing = e_easing::EASE_IN_OUT);
+        void fadeTo(const WidgetHandle& widget, float opacity, float duration, e_easing easing = e_easing::LINEAR);
+
+        // Stop the tweens of a widget where they are
+        void stop(const WidgetHandle& widget);
+
+        // Advance every tween (once per frame, before rendering)
+        void update(float seconds);
+
+        // Running tweens
+        auto size() const noexcept -> std::size_t;
+
+
+    private:
+
+        // Remove a tween, the last one takes its place (arrays stay packed)
+        void remove(std::size_t index);
+
+        // Current value of a widget property
+        static auto getValue(const IWidget& widget, e_property property) -> Vec2;
+
+
+        UserInterface& m_ui;
+
+        // --- Tweens (one entry per tween in every array) ---
+        // Seconds since the start (negative while delayed) and 1 / duration
+        std::vector<float> m_elapsed, m_invDuration;
+        // Easing polynomial coefficients
+        std::vector<float> m_a, m_b, m_c;
+        // Start value and distance to the target
+        std::vector<float> m_from0, m_from1, m_delta0, m_delta1;
+        // Kernel results
+        std::vector<float> m_progress, m_value0, m_value1;
+
+        // Cold data
+        std::vector<WidgetHandle> m_widgets;
+        std::vector<e_property> m_properties;
+        std::vector<t_finished> m_finished;
+
+        // Tweens ended in the last update and their callbacks (members to reuse their memory)
+        std::vector<std::size_t> m_ended;
+        std::vector<t_finished> m_endedCallbacks;
+
+};
+
+
+// cpp
+// ctor
+Animator::Animator(UserInterface& ui)
+    : m_ui(ui)
+{
+}
+
+
+// Animate a property from its current value (a running tween of the same property is replaced)
+void Animator::animate(const WidgetHandle& widget, e_property property, const Vec2& target, float duration,
+                       e_easing easing, float delay, t_finished&& finished)
+{
+    const auto* instance = m_ui.get(widget);
+
+    if (!instance)
+        return;
+
+    // Coefficients of a * t^3 + b * t^2 + c * t
+    struct Curve
+    {
+        float a, b, c;
+    };
+
+    static constexpr Curve CURVES[] =
+    {
+        {  0.0f,  0.0f, 1.0f },     // LINEAR
+        {  0.0f,  1.0f, 0.0f },     // EASE_IN
+        {  0.0f, -1.0f, 2.0f },     // EASE_OUT
+        { -2.0f,  3.0f, 0.0f },     // EASE_IN_OUT
+        {  1.0f, -3.0f, 3.0f }      // EASE_OUT_CUBIC
+    };
+
+    const auto& curve = CURVES[static_cast<std::size_t>(easing)];
+    const auto from = getValue(*instance, property);
+
+    // Zero durations end on the next update
+    constexpr float MIN_DURATION = 1e-6f;
+
+    for (std::size_t i = 0; i < m_widgets.size(); ++i)
+        if (m_widgets[i] == widget && m_properties[i] == property)
+        {
+            remove(i);
+            break;
+        }
+
+    m_elapsed.push_back(-std::max(delay, 0.0f));
+    m_invDuration.push_back(1.0f / std::max(duration, MIN_DURATION));
+
+    m_a.push_back(curve.a);
+    m_b.push_back(curve.b);
+    m_c.push_back(curve.c);
+
+    m_from0.push_back(from.x);
+    m_from1.push_back(from.y);
+    m_delta0.push_back(target.x - from.x);
+    m_delta1.push_back(target.y - from.y);
+
+    m_progress.push_back(0.0f);
+    m_value0.push_back(from.x);
+    m_value1.push_back(from.y);
+
+    m_widgets.push_back(widget);
+    m_properties.push_back(property);
+    m_finished.push_back(std::move(finished));
+}
+
+
+// Shortcuts
+void Animator::moveTo(const WidgetHandle& widget, const Vec2& position, float duration, e_easing easing)
+{
+    animate(widget, e_property::POSITION, position, duration, easing);
+}
+
+void Animator::resizeTo(const WidgetHandle& widget, const Vec2& size, float duration, e_easing easing)
+{
+    animate(widget, e_property::SIZE, size, duration, easing);
+}
+
+void Animator::fadeTo(const WidgetHandle& widget, float opacity, float duration, e_easing easing)
+{
+    animate(widget, e_property::OPACITY, { opacity, 0.0f }, duration, easing);
+}
+
+
+// Stop the tweens of a widget where they are
+void Animator::stop(const WidgetHandle& widget)
+{
+    for (auto i = m_widgets.size(); i-- > 0; )
+        if (m_widgets[i] == widget)
+            remove(i);
+}
+
+
+// Advance every tween (once per frame, before rendering)
+void Animator::update(float seconds)
+{
+    if (m_widgets.empty())
+        return;
+
+    simd::advanceTweens({ m_elapsed.data(), m_invDuration.data(), m_a.data(), m_b.data(), m_c.data(),
+                          m_from0.data(), m_from1.data(), m_delta0.data(), m_delta1.data(),
+                          m_progress.data(), m_value0.data(), m_value1.data(), m_widgets.size() }, seconds);
+
+    // Apply the new values (delayed tweens are not started yet)
+    m_ended.clear();
+
+    for (std::size_t i = 0; i < m_widgets.size(); ++i)
+    {
+        auto* widget = m_ui.get(m_widgets[i]);
+
+        // Removed: the tween ends silently
+        if (!widget)
+        {
+            m_finished[i] = t_finished{};
+            m_ended.push_back(i);
+            continue;
+        }
+
+        if (m_elapsed[i] < 0.0f)
+            continue;
+
+        switch (m_properties[i])
+        {
+            case e_property::POSITION:
+                widget->moveTo({ m_value0[i], m_value1[i] });
+                break;
+
+            case e_property::SIZE:
+                widget->resizeTo({ m_value0[i], m_value1[i] });
+                break;
+
+            case e_property::OPACITY:
+                widget->setOpacity(m_value0[i]);
+                break;
+        }
+
+        if (m_progress[i] >= 1.0f)
+            m_ended.push_back(i);
+    }
+
+    if (m_ended.empty())
+        return;
+
+    // Removed from the back, so the indices still to remove don't move
+    // The callbacks run last: they may start new tweens
+    m_endedCallbacks.clear();
+
+    for (auto i = m_ended.rbegin(); i != m_ended.rend(); ++i)
+    {
+        if (m_finished[*i])
+            m_endedCallbacks.push_back(std::move(m_finished[*i]));
+
+        remove(*i);
+    }
+
+    // Swapped out while they run (a callback may start tweens or update again)
+    std::vector<t_finished> finished;
+    std::swap(finished, m_endedCallbacks);
+
+    for (auto callback = finished.rbegin(); callback != finished.rend(); ++callback)
+        (*callback)();
+
+    // Memory given back for the next update
+    finished.clear();
+
+    if (finished.capacity() > m_endedCallbacks.capacity())
+        std::swap(finished, m_endedCallbacks);
+}
+
+
+// Running tweens
+auto Animator::size() const noexcept -> std::size_t
+{
+    return m_widgets.size();
+}
+
+
+// Remove a tween, the last one takes its place (arrays stay packed)
+void Animator::remove(std::size_t index)
+{
+    const auto last = m_widgets.size() - 1;
+
+    const auto swapRemove = [index, last](auto& values)
+    {
+        if (index != last)
+            values[index] = std::move(values[last]);
+
+        values.pop_back();
+    };
+
+    swapRemove(m_elapsed);
+    swapRemove(m_invDuration);
+    swapRemove(m_a);
+    swapRemove(m_b);
+    swapRemove(m_c);
+    swapRemove(m_from0);
+    swapRemove(m_from1);
+    swapRemove(m_delta0);
+    swapRemove(m_delta1);
+    swapRemove(m_progress);
+    swapRemove(m_value0);
+    swapRemove(m_value1);
+
+    swapRemove(m_widgets);
+    swapRemove(m_properties);
+    swapRemove(m_finished);
+}
+
 
-        // Widget type
-        e_widgetType m_type;
+// Current value of a widget property
+auto Animator::getValue(const IWidget& widget, e_property property) -> Vec2
+{
+    const auto local = widget.getLocalDimension();
 
-        // Position and size
-        Rect<float> m_dimension;
+    switch (property)
+    {
+        case e_property::POSITION:
+            return { local.x, local.y };
 
-        // Other attributes
-        bool m_active;
-        bool m_visible;
-        bool m_resizable;
-        bool m_movable;
+        case e_property::SIZE:
+            return { local.w, local.h };
 
-};
+        case e_property::OPACITY:
+            return { widget.getOpacity(), 0.0f };
+    }
 
+    return {};
+}
 
-// cpp
-// ctor
-IWidget::IWidget(e_widgetType type, Rect<float>&& dimension)
-    : m_type(type),
-      m_dimension(std::move(dimension)),
 
-      // Default settings
-      m_active(true),
-      m_visible(true),
-      m_resizable(false),
-      m_movable(false)
+// -----------------------------------------------------------------
+// Headless replay of a recording (EventRecorder), at full speed:
+// the events of every recorded frame are queued and dispatched, then
+// the frame is rendered, so the same UI gets the same frames
+// (build the same widgets before replaying; tasks posted by other
+// threads are not part of the recording)
+// -----------------------------------------------------------------
+class EventReplay
 {
-}
+    public:
 
+        // Replay results
+        struct Stats
+        {
+            std::size_t frames = 0;
+            std::size_t events = 0;
 
+            // Time of the whole replay, and of the recording
+            double replayMicros = 0.0;
+            double recordedMicros = 0.0;
+
+            // Slowest replayed frame (dispatch and render)
+            std::size_t slowestFrame = 0;
+            double slowestFrameMicros = 0.0;
+        };
 
-// -------------------
-// Example GUI widgets
-// -------------------
-// Clickable button
-class Button final : public IWidget
-{
 
     public:
 
-        // The slot will be called on button click events
-        using t_slot = std::function<void()>;
+        // false if the file can't be read or it isn't a valid recording
+        auto open(const std::string& path) -> bool;
+        auto load(std::string_view data) -> bool;
 
-        // Define button size
-        enum class e_buttonSize { SMALL, MEDIUM, LARGE };
+        // Recorded frames and events
+        auto getFrameCount() const noexcept -> std::size_t;
+        auto getEventCount() const noexcept -> std::size_t;
 
+        // Replay every frame (render: draw each frame too)
+        auto run(UserInterface& ui, bool render = true) const -> Stats;
 
-    public:
 
-        // ctor
-        Button(const AppTheme& theme,
-               Rect<float>&& dimension, std::string_view text, t_slot&& clickedSlot,
-               e_buttonSize buttonSize = e_buttonSize::SMALL);
+    private:
 
+        using t_clock = std::chrono::steady_clock;
 
-        // Virtual functions override:
-        void onClick(const SDL_Event& event) override;
+        // Events of a frame: from the end of the previous one to end
+        struct Frame
+        {
+            std::uint32_t end;
+            std::uint64_t recordedMicros;
+        };
 
-        // Mouse over/leave modify the hover state
-        void onMouseOver()  override;
-        void onMouseLeave() override;
 
-        // Accept a rendering visitor
-        void accept(const RenderUI& renderer) const override;
+        std::vector<SDL_Event> m_events;
+        std::vector<Frame> m_frames;
 
-        // Getters:
-        auto getText() const noexcept -> std::string_view;
-        auto getButtonSize() const noexcept -> e_buttonSize;
-        auto isOnHover() const -> bool;
+};
 
 
-    private:
+// cpp
+// false if the file can't be read or it isn't a valid recording
+auto EventReplay::open(const std::string& path) -> bool
+{
+    MappedFile file;
 
-        // Button text
-        std::string m_text;
-        // Button size
-        e_buttonSize m_size;
+    return file.open(path) && load(file.getData());
+}
 
-        // Hover status
-        bool m_hover;
+auto EventReplay::load(std::string_view data) -> bool
+{
+    m_events.clear();
+    m_frames.clear();
 
-        // Callback for button clicked event
-        t_slot m_slot;
+    std::uint32_t header[2] = {};
 
-};
+    if (data.size() < sizeof(header))
+        return false;
 
+    std::memcpy(header, data.data(), sizeof(header));
 
-// cpp
-// ctor
-Button::Button([[maybe_unused]] const AppTheme& theme,
-               Rect<float>&& dimension, std::string_view text, t_slot&& clickedSlot, e_buttonSize buttonSize)
+    if (header[0] != eventlog::MAGIC || header[1] != eventlog::VERSION)
+        return false;
 
-    : IWidget(e_widgetType::BUTTON, std::move(dimension)),
+    std::size_t offset = sizeof(header);
+    std::uint64_t micros = 0;
+    std::int64_t timestamp = 0, x = 0, y = 0;
 
-      m_text(text),
-      m_size(buttonSize),
-      m_hover(false),
+    // SDL timestamp and position, as deltas
+    const auto getEventHeader = [&]() -> bool
+    {
+        std::int64_t deltaTimestamp = 0, deltaX = 0, deltaY = 0;
 
-      m_slot(std::move(clickedSlot))
-{
-}
+        if (!eventlog::getSigned(data, offset, deltaTimestamp) ||
+            !eventlog::getSigned(data, offset, deltaX) ||
+            !eventlog::getSigned(data, offset, deltaY))
+            return false;
 
+        timestamp += deltaTimestamp;
+        x += deltaX;
+        y += deltaY;
+        return true;
+    };
 
-// Virtual functions override:
-void Button::onClick(const SDL_Event& event)
-{
+    while (offset < data.size())
+    {
+        const auto kind = static_cast<eventlog::e_record>(data[offset++]);
+        std::uint64_t delta = 0;
 
-    cout << " -> Button::onClick() -> \'" << m_text << '\'' << endl;
+        if (!eventlog::getVarint(data, offset, delta))
+            return false;
 
-    // If left mouse button is clicked, invoke slot function
-    //if (event.button.button == SDL_BUTTON_LEFT)
-        std::invoke(m_slot);
-}
+        micros += delta;
 
-// Mouse over/leave modify the hover state
-void Button::onMouseOver()
-{
-    m_hover = true;
-}
+        SDL_Event event{};
 
-void Button::onMouseLeave()
-{
-    m_hover = false;
-}
+        switch (kind)
+        {
+            case eventlog::e_record::FRAME:
+            {
+                m_frames.push_back({ static_cast<std::uint32_t>(m_events.size()), micros });
+                continue;
+            }
+
+            case eventlog::e_record::MOTION:
+            {
+                std::int64_t xrel = 0, yrel = 0;
+
+                if (!getEventHeader() || !eventlog::getSigned(data, offset, xrel) || !eventlog::getSigned(data, offset, yrel))
+                    return false;
+
+                event.motion = { SDL_MOUSEMOTION, static_cast<std::uint32_t>(timestamp), static_cast<std::int32_t>(x), static_cast<std::int32_t>(y),
+                                 static_cast<std::int32_t>(xrel), static_cast<std::int32_t>(yrel) };
+                break;
+            }
+
+            case eventlog::e_record::BUTTON_DOWN:
+            case eventlog::e_record::BUTTON_UP:
+            {
+                if (!getEventHeader() || offset + 2 > data.size())
+                    return false;
+
+                const auto button = static_cast<std::uint8_t>(data[offset++]);
+                const auto clicks = static_cast<std::uint8_t>(data[offset++]);
+
+                event.button = { kind == eventlog::e_record::BUTTON_DOWN ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP,
+                                 static_cast<std::uint32_t>(timestamp), button, clicks, static_cast<std::int32_t>(x), static_cast<std::int32_t>(y) };
+                break;
+            }
+
+            case eventlog::e_record::WHEEL:
+            {
+                std::int64_t wheelX = 0, wheelY = 0;
+
+                if (!getEventHeader() || !eventlog::getSigned(data, offset, wheelX) || !eventlog::getSigned(data, offset, wheelY))
+                    return false;
+
+                event.wheel = { SDL_MOUSEWHEEL, static_cast<std::uint32_t>(timestamp), static_cast<std::int32_t>(wheelX), static_cast<std::int32_t>(wheelY) };
+                break;
+            }
+
+            default:
+                return false;
+        }
 
+        m_events.push_back(event);
+    }
 
-// Accept a rendering visitor
-void Button::accept(const RenderUI& renderer) const
-{
-    renderer.render(*this);
+    // Events not dispatched before the recording ended: one more frame
+    if (m_frames.empty() || m_frames.back().end != m_events.size())
+        m_frames.push_back({ static_cast<std::uint32_t>(m_events.size()), micros });
+
+    return true;
 }
 
 
-// Getters:
-auto Button::getText() const noexcept -> std::string_view
+// Recorded frames and events
+auto EventReplay::getFrameCount() const noexcept -> std::size_t
 {
-    return m_text;
+    return m_frames.size();
 }
 
-auto Button::getButtonSize() const noexcept -> e_buttonSize
+auto EventReplay::getEventCount() const noexcept -> std::size_t
 {
-    return m_size;
+    return m_events.size();
 }
 
-auto Button::isOnHover() const -> bool
+
+// Replay every frame (render: draw each frame too)
+auto EventReplay::run(UserInterface& ui, bool render) const -> Stats
 {
-    return m_hover;
+    Stats stats;
+    stats.frames = m_frames.size();
+    stats.events = m_events.size();
+    stats.recordedMicros = m_frames.empty() ? 0.0 : static_cast<double>(m_frames.back().recordedMicros);
+
+    const auto start = t_clock::now();
+    std::uint32_t first = 0;
+
+    for (std::size_t frame = 0; frame < m_frames.size(); ++frame)
+    {
+        const auto frameStart = t_clock::now();
+
+        for (auto i = first; i < m_frames[frame].end; ++i)
+            ui.processEvent(m_events[i]);
+
+        ui.dispatchEvents();
+
+        if (render)
+            ui.render();
+
+        const auto micros = std::chrono::duration<double, std::micro>(t_clock::now() - frameStart).count();
+
+        if (micros > stats.slowestFrameMicros)
+        {
+            stats.slowestFrame = frame;
+            stats.slowestFrameMicros = micros;
+        }
+
+        first = m_frames[frame].end;
+    }
+
+    stats.replayMicros = std::chrono::duration<double, std::micro>(t_clock::now() - start).count();
+
+    return stats;
 }
 
 
-// A box that can be marked as checked
-class Checkbox final : public IWidget
+#if defined(UI_BENCHMARK)
+
+// ------------------------------------------------------------------
+// Benchmark (build with -DUI_BENCHMARK, and -DUI_PROFILING=0 to
+// measure without the profiler): synthetic Button/Checkbox populations
+// from 10 to 1M widgets (or the count given as first argument)
+// - add:       widgets created per second
+// - dispatch:  time per synthetic event (motion, clicks, wheel)
+// - pick:      time per hit-test
+// - render:    full frame (everything dirty) and one changed widget
+// - drag:      moving a selection of up to 10000 widgets (no render)
+//
+// "record <file> [count]" saves the synthetic events of a population
+// (frames of 100 events), "replay <file> [count]" replays a recording
+// headless against the same population
+//
+// "backends [count]" draws the same population and events with the
+// software and tiled backends, and fails if their frames differ
+// ------------------------------------------------------------------
+namespace benchmark
 {
+    using t_clock = std::chrono::steady_clock;
 
-    public:
+    // Counts the draw calls, draws nothing
+    class NullBackend final : public IRenderBackend
+    {
+        public:
 
-        // ctor
-        Checkbox(const AppTheme& theme,
-                 Rect<float>&& dimension, std::string text,
-                 bool checked = false, bool grayedOut = false);
+            void drawBatch(const DrawBatch& batch, const std::vector<DrawCommand>&, std::string_view) override
+            {
+                m_commands += batch.count;
+            }
 
+            auto getCommands() const noexcept -> std::size_t
+            {
+                return m_commands;
+            }
 
-        // Virtual functions override:
-        void onClick(const SDL_Event& event) override;
+        private:
 
-        // Accept a rendering visitor
-        void accept(const RenderUI& renderer) const override;
+            std::size_t m_commands = 0;
+    };
 
-        // Getters
-        auto getText() const noexcept -> std::string_view;
-        auto isChecked() const noexcept -> bool;
-        auto isGreyedOut() const noexcept -> bool;
+    // Nanoseconds since start
+    inline auto elapsed(t_clock::time_point start) -> double
+    {
+        return std::chrono::duration<double, std::nano>(t_clock::now() - start).count();
+    }
 
+    // Small deterministic random numbers (same populations every run)
+    class Random
+    {
+        public:
 
-    private:
+            explicit Random(std::uint64_t seed) : m_state(seed) {}
 
-        // Optional text string
-        std::string m_text;
+            // 0 <= value < range
+            auto next(std::uint32_t range) noexcept -> std::uint32_t
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 7;
+                m_state ^= m_state << 17;
 
-        // Current status
-        bool m_checked;
-        // Can it be checked?
-        // or is it grayed out?
-        bool m_greyedOut;
+                return static_cast<std::uint32_t>(m_state % range);
+            }
 
-};
+        private:
 
+            std::uint64_t m_state;
+    };
 
-// cpp
-// ctor
-Checkbox::Checkbox([[maybe_unused]] const AppTheme& theme,
-                   Rect<float>&& dimension, std::string text, bool checked, bool grayedOut)
+    // Side of the square populated by count widgets
+    // (same density at every size: about one widget per 100x100 pixels)
+    inline auto getSide(std::size_t count) -> std::uint32_t
+    {
+        return static_cast<std::uint32_t>(std::sqrt(static_cast<double>(count)) * 100.0) + 100;
+    }
 
-    : IWidget(e_widgetType::CHECKBOX, std::move(dimension)),
+    // Buttons and checkboxes at random positions (same ones for the same random state)
+    auto populate(UserInterface& ui, std::size_t count, Random& random) -> std::vector<WidgetHandle>
+    {
+        constexpr float WIDGET_SIZE = 40.0f;
 
-      m_text(std::move(text)),
-      m_checked(checked),
-      m_greyedOut(grayedOut)
-{
-}
+        const auto side = getSide(count);
 
+        std::vector<WidgetHandle> widgets;
+        widgets.reserve(count);
 
-// Virtual functions override:
-void Checkbox::onClick([[maybe_unused]] const SDL_Event& event)
-{
-    cout << " -> Checkbox::onClick() -> \'" << m_text << '\'' << endl;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Rect<float> rect{ static_cast<float>(random.next(side)), static_cast<float>(random.next(side)), WIDGET_SIZE, WIDGET_SIZE };
 
-    // If it's not disabled, toggle checked status
-    if (!m_greyedOut /* && event.button.button == SDL_BUTTON_LEFT */)
-        m_checked = !m_checked;
-}
+            if (i % 2)
+                widgets.push_back(ui.add<Button>(std::move(rect), "Button", []() {}));
+            else
+                widgets.push_back(ui.add<Checkbox>(std::move(rect), "Checkbox", (i % 4) == 0));
+        }
 
-// Accept a rendering visitor
-void Checkbox::accept(const RenderUI& renderer) const
-{
-    renderer.render(*this);
-}
+        return widgets;
+    }
 
+    // Motions, clicks and wheel steps at random positions
+    auto syntheticEvent(std::size_t index, std::uint32_t side, Random& random) -> SDL_Event
+    {
+        const auto x = static_cast<std::int32_t>(random.next(side));
+        const auto y = static_cast<std::int32_t>(random.next(side));
 
-// Getters
-auto Checkbox::getText() const noexcept -> std::string_view
-{
-    return m_text;
-}
+        SDL_Event event{};
 
-auto Checkbox::isChecked() const noexcept -> bool
-{
-    return m_checked;
-}
+        switch (index % 4)
+        {
+            case 0:  event.motion = { SDL_MOUSEMOTION, 0, x, y, 0, 0 }; break;
+            case 1:  event.button = { SDL_MOUSEBUTTONDOWN, 0, SDL_BUTTON_LEFT, 1, x, y }; break;
+            case 2:  event.button = { SDL_MOUSEBUTTONUP, 0, SDL_BUTTON_LEFT, 1, x, y }; break;
+            default: event.wheel  = { SDL_MOUSEWHEEL, 0, 0, 1 }; break;
+        }
 
-auto Checkbox::isGreyedOut() const noexcept -> bool
-{
-    return m_greyedOut;
-}
+        return event;
+    }
 
+    // One population of count widgets
+    void run(std::size_t count)
+    {
+        constexpr std::size_t EVENTS = 10000;
+        constexpr std::size_t PICKS  = 100000;
+
+        const auto side = getSide(count);
+
+        AppTheme theme;
+        NullBackend backend;
+        RenderUI renderer(backend);
+        UserInterface ui(renderer, theme);
+        Random random(count);
+
+        // add
+        auto start = t_clock::now();
+        const auto widgets = populate(ui, count, random);
+        const auto addNanos = elapsed(start);
+
+        // render: everything is dirty after adding
+        start = t_clock::now();
+        ui.render();
+        const auto fullRenderNanos = elapsed(start);
+
+        // dispatch: motions, clicks and wheel steps at random positions
+        // (the widgets print their clicks: muted meanwhile)
+        auto* output = cout.rdbuf(nullptr);
+
+        for (std::size_t i = 0; i < EVENTS; ++i)
+            ui.processEvent(syntheticEvent(i, side, random));
+
+        start = t_clock::now();
+        ui.dispatchEvents();
+        const auto dispatchNanos = elapsed(start);
+
+        cout.rdbuf(output);
+
+        // Frame after the clicks (only the touched widgets)
+        start = t_clock::now();
+        ui.render();
+        const auto eventsRenderNanos = elapsed(start);
+
+        // pick
+        std::size_t hits = 0;
+        start = t_clock::now();
+
+        for (std::size_t i = 0; i < PICKS; ++i)
+            hits += ui.pick({ static_cast<float>(random.next(side)), static_cast<float>(random.next(side)) }) != nullptr;
+
+        const auto pickNanos = elapsed(start);
+
+        // render: one widget moved
+        ui.get(widgets[count / 2])->moveOffset({ 5.0f, 5.0f });
+
+        start = t_clock::now();
+        ui.render();
+        const auto smallRenderNanos = elapsed(start);
+
+        // drag: a selection follows the mouse
+        constexpr std::size_t DRAG_SELECTION = 10000;
+        constexpr std::size_t DRAG_STEPS     = 10;
+
+        const std::vector<WidgetHandle> selection(widgets.begin(), widgets.begin() + std::min(count, DRAG_SELECTION));
+        start = t_clock::now();
+
+        for (std::size_t i = 0; i < DRAG_STEPS; ++i)
+            ui.moveSelection(selection, { 3.0f, 2.0f });
+
+        const auto dragNanos = elapsed(start);
+
+        // render: everything again, under a modal panel covering the whole population
+        const auto cover = static_cast<float>(side) + 100.0f;
+        const auto modal = ui.add<Panel>(Rect<float>{ -50.0f, -50.0f, cover, cover });
+        ui.setLayer(modal, UserInterface::e_layer::MODAL);
+        ui.invalidate();
+
+        start = t_clock::now();
+        ui.render();
+        const auto modalRenderNanos = elapsed(start);
+
+        std::printf("%9zu | %10.0f | %8.0f | %7.0f | %10.3f | %11.3f | %9.3f | %8.3f | %8.3f | %8.3f | %zu commands, %zu hits\n",
+                    count,
+                    static_cast<double>(count) / (addNanos * 1e-9),
+                    dispatchNanos / EVENTS,
+                    pickNanos / PICKS,
+                    fullRenderNanos * 1e-6,
+                    fullRenderNanos * 1e-3 / static_cast<double>(count),
+                    eventsRenderNanos * 1e-6,
+                    smallRenderNanos * 1e-6,
+                    dragNanos * 1e-6 / DRAG_STEPS,
+                    modalRenderNanos * 1e-6,
+                    backend.getCommands(), hits);
+    }
+
+    // Record frames of synthetic events against a population of count widgets
+    auto record(const std::string& path, std::size_t count) -> bool
+    {
+        constexpr std::size_t FRAMES = 100;
+        constexpr std::size_t FRAME_EVENTS = 100;
 
+        AppTheme theme;
+        NullBackend backend;
+        RenderUI renderer(backend);
+        UserInterface ui(renderer, theme);
+        Random random(count);
+        EventRecorder recorder;
 
-// -------------------------------------------------
-// Graphical User Interface main class
-// - Widget factory
-// - Owns, updates and renders every active widget
-// -------------------------------------------------
-class UserInterface
-{
-    public:
+        populate(ui, count, random);
+        ui.render();
+        ui.setEventRecorder(&recorder);
 
-        // ctor
-        UserInterface(const RenderUI& renderer, const AppTheme& theme)
-            : m_theme(theme), m_renderer(renderer)
+        auto* output = cout.rdbuf(nullptr);
+
+        for (std::size_t frame = 0; frame < FRAMES; ++frame)
         {
+            for (std::size_t i = 0; i < FRAME_EVENTS; ++i)
+                ui.processEvent(syntheticEvent(i, getSide(count), random));
+
+            ui.dispatchEvents();
+            ui.render();
         }
 
+        cout.rdbuf(output);
 
-        // Adds a new GUI widget
-        template <typename WidgetType, typename... Args>
-        auto add(Args... args) -> IWidget*;
+        std::printf("%zu frames recorded, %zu bytes\n", FRAMES, recorder.getData().size());
+        return recorder.save(path);
+    }
 
-        // Process a system event
-        void processEvent(const SDL_Event& event);
+    // Replay a recording against a population of count widgets
+    auto replay(const std::string& path, std::size_t count) -> bool
+    {
+        EventReplay events;
 
-        // Renders everything
-        void render() const noexcept;
+        if (!events.open(path))
+            return false;
 
+        AppTheme theme;
+        NullBackend backend;
+        RenderUI renderer(backend);
+        UserInterface ui(renderer, theme);
+        Random random(count);
 
-    private:
+        populate(ui, count, random);
+        ui.render();
 
+        auto* output = cout.rdbuf(nullptr);
+        const auto stats = events.run(ui);
+        cout.rdbuf(output);
 
-        // --- Widgets -----------------------------------------------------------
-        // Define widgets container data structure
-        using t_widgetsContainer = std::vector<IWidget::t_widgetPtr>;
+        std::printf("%zu frames, %zu events: replay %.3f ms (recorded %.3f ms), slowest frame #%zu %.3f ms, %zu commands\n",
+                    stats.frames, stats.events, stats.replayMicros * 1e-3, stats.recordedMicros * 1e-3,
+                    stats.slowestFrame, stats.slowestFrameMicros * 1e-3, backend.getCommands());
+        return true;
+    }
 
-        // Owner of all GUI widgets
-        t_widgetsContainer m_widgets;
+    // Same population and events drawn by the software backends, their frames must be identical
+    auto compareBackends(std::size_t count) -> bool
+    {
+        constexpr std::size_t FRAMES = 50;
+        constexpr std::size_t FRAME_EVENTS = 20;
+        constexpr std::int32_t WIDTH  = 1280;
+        constexpr std::int32_t HEIGHT = 720;
 
-        // On which element the mouse is over
-        IWidget* m_currentMouseOver = nullptr;
+        ThreadPool pool;
 
-        // --- Graphics ----------------------------------------------------------
-        // Skin & Theme
-        const AppTheme& m_theme;
+        AppTheme softwareTheme;
+        Framebuffer softwareTarget(WIDTH, HEIGHT);
+        SoftwareBackend software(softwareTarget, softwareTheme);
+        RenderUI softwareRenderer(software);
+        UserInterface softwareUi(softwareRenderer, softwareTheme);
 
-        // Widgets renderer
-        const RenderUI& m_renderer;
+        AppTheme tiledTheme;
+        Framebuffer tiledTarget(WIDTH, HEIGHT);
+        TiledSoftwareBackend tiled(tiledTarget, pool, tiledTheme);
+        RenderUI tiledRenderer(tiled);
+        UserInterface tiledUi(tiledRenderer, tiledTheme);
 
-};
+        Random softwareRandom(count);
+        Random tiledRandom(count);
+        Random events(count + 1);
 
+        populate(softwareUi, count, softwareRandom);
+        populate(tiledUi, count, tiledRandom);
 
+        double softwareNanos = 0.0;
+        double tiledNanos = 0.0;
+        std::size_t differences = 0;
+        std::size_t worstFrame = 0;
+        std::size_t worstDifferences = 0;
 
-// --- Template functions implementation ---
-// Adds a new GUI widget
-//
-// Awesome Variadic Templates article:
-// https://eli.thegreenplace.net/2014/variadic-templates-in-c/
-template <typename WidgetType, typename... Args>
-auto UserInterface::add(Args... args) -> IWidget*
-{
+        auto* output = cout.rdbuf(nullptr);
 
-    // This WidgetType MUST inherit from IWidget
-    static_assert(std::is_base_of_v<IWidget, WidgetType>, "<WidgetType> MUST inherit from <IWidget>!");
+        for (std::size_t frame = 0; frame < FRAMES; ++frame)
+        {
+            for (std::size_t i = 0; frame > 0 && i < FRAME_EVENTS; ++i)
+            {
+                const auto event = syntheticEvent(i, getSide(count), events);
 
-    // Create widget
-    m_widgets.emplace_back(std::make_unique<WidgetType>(m_theme, std::forward<Args>(args)...));
+                softwareUi.processEvent(event);
+                tiledUi.processEvent(event);
+            }
 
-    // Return a raw pointer to it
-    return m_widgets.back().get();
+            softwareUi.dispatchEvents();
+            tiledUi.dispatchEvents();
 
-}
+            auto start = t_clock::now();
+            softwareUi.render();
+            softwareNanos += elapsed(start);
 
+            start = t_clock::now();
+            tiledUi.render();
+            tiledNanos += elapsed(start);
 
-// cpp
-// Process a system event
-void UserInterface::processEvent([[maybe_unused]] const SDL_Event& event)
-{
-    // Process OS events here...
+            std::size_t frameDifferences = 0;
+
+            for (std::int32_t y = 0; y < HEIGHT; ++y)
+                for (std::int32_t x = 0; x < WIDTH; ++x)
+                    frameDifferences += softwareTarget.row(y)[x] != tiledTarget.row(y)[x];
+
+            differences += frameDifferences;
+
+            if (frameDifferences > worstDifferences)
+            {
+                worstDifferences = frameDifferences;
+                worstFrame = frame;
+            }
+        }
+
+        cout.rdbuf(output);
+
+        std::printf("%zu widgets, %zu frames %dx%d: software %.3f ms, tiled %.3f ms (%zu workers) per frame, ",
+                    count, FRAMES, WIDTH, HEIGHT, softwareNanos * 1e-6 / FRAMES, tiledNanos * 1e-6 / FRAMES, pool.size());
+
+        if (differences == 0)
+            std::printf("identical frames\n");
+        else
+            std::printf("%zu different pixels (worst frame #%zu: %zu)\n", differences, worstFrame, worstDifferences);
+
+        return differences == 0;
+    }
 }
 
-void UserInterface::render() const noexcept
+
+int main(int argc, char* argv[])
 {
-    // Iterate through every widget
-    for (const auto& widget : m_widgets)
-        widget->accept(m_renderer);
+    const std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "record" || mode == "replay")
+    {
+        if (argc < 3)
+        {
+            std::printf("usage: %s %s <file> [count]\n", argv[0], mode.c_str());
+            return 1;
+        }
+
+        const std::size_t count = argc > 3 ? std::stoul(argv[3]) : 10000;
+        const auto done = mode == "record" ? benchmark::record(argv[2], count) : benchmark::replay(argv[2], count);
+
+        if (!done)
+            std::printf("can't %s '%s'\n", mode.c_str(), argv[2]);
+
+        return done ? 0 : 1;
+    }
+
+    // Software and tiled backends draw the same frames
+    if (mode == "backends")
+    {
+        const std::size_t count = argc > 2 ? std::stoul(argv[2]) : 1000;
+
+        return benchmark::compareBackends(count) ? 0 : 1;
+    }
+
+    const std::size_t maximum = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+    std::printf("  widgets |      add/s | event ns | pick ns |    full ms | full us/wdg | events ms |  move ms |  drag ms | modal ms |\n");
+
+    for (std::size_t count = 10; count <= maximum; count *= 10)
+        benchmark::run(count);
+
+    return 0;
 }
 
+#else
+
 
 /*
 
 Main entry point
 
 Output:
-- Rendering a Checkbox
-- Rendering a Checkbox
-- Rendering a Button
+Tooltip removed
+ -> Button::onClick() -> 'Button1'
+Button 1 CLICKED!
+ -> Checkbox::onClick() -> 'Use VSync'
+ -> Checkbox::onClick() -> 'Fullscreen'
+Fullscreen ON
+Button 1 CLICKED! (queued)
+- Draw call: 6 quad(s)
+- Draw call: 22 quad(s)
+- Draw call: 2 text run(s): 'Use VSync' 'Emit sound effects'
+- Draw call: 4 image(s)
+- Draw call: 7 text run(s): 'Button1' 'Fullscreen' 'Item 6' 'Item 2' 'Item 3' 'Item 4' 'Item 5'
 
 */
 int main()
 {
 
     // Create the RenderUI & AppTheme objects
-    RenderUI rendering;
+    // (frames are drawn on a render thread, it must be destroyed before the theme)
     AppTheme theming;
+    ConsoleBackend backend;
+    RenderThread renderThread(backend);
+    RenderUI rendering(renderThread);
 
     // Create the GUI main class
     UserInterface ui(rendering, theming);
@@ -475,19 +8685,101 @@ int main()
     // Make some UI elements!
     // Checkboxes
     ui.add<Checkbox>(Rect<float>{ 300.0f, 420.0f, 40.0f, 40.0f }, "Use VSync", true);
-    ui.add<Checkbox>(Rect<float>{ 300.0f, 470.0f, 40.0f, 40.0f }, "Emit sound effects", false);
+    const auto sound = ui.add<Checkbox>(Rect<float>{ 300.0f, 470.0f, 40.0f, 40.0f }, "Emit sound effects", false);
     // Buttons
-    ui.add<Button>(Rect<float>{ 550.0f, 720.0f, 150.0f, 50.0f }, "Button1", []()
+    const auto button = ui.add<Button>(Rect<float>{ 550.0f, 720.0f, 150.0f, 50.0f }, "Button1", []()
     {
         cout << "Button 1 CLICKED!" << endl;
     });
+    // Another subscriber, called after the events are dispatched
+    ui.get<Button>(button)->getClickedSignal().connect([]()
+    {
+        cout << "Button 1 CLICKED! (queued)" << endl;
+    }, ui.getDispatcher());
+    // Panel with a checkbox inside (children are positioned relative to their parent)
+    // Normally compiled at build time, the UI only instantiates the blob
+    const auto settingsLayout = layout::compile(R"(
+        Panel id=settings rect=-220,50,220,120
+            Checkbox id=fullscreen rect=20,20,40,40 text="Fullscreen"
+    )");
+    const auto settings = ui.instantiate(settingsLayout);
+
+    ui.get<Checkbox>(settings.find("fullscreen"))->getToggledSignal().connect([](bool checked)
+    {
+        cout << "Fullscreen " << (checked ? "ON" : "OFF") << endl;
+    });
+    // List with lots of rows (only the visible ones have a widget)
+    const auto list = ui.add<ListView>(Rect<float>{ 400.0f, 50.0f, 200.0f, 130.0f }, [](std::size_t row, Checkbox& widget)
+    {
+        widget.setText("Item " + std::to_string(row));
+        widget.setChecked(row % 3 == 0);
+    });
+    ui.get<ListView>(list)->setRows(100000, 30.0f);
+
+    // The settings panel slides in from the left
+    Animator animator(ui);
+    animator.moveTo(settings.find("settings"), { 50.0f, 50.0f }, 0.25f, Animator::e_easing::EASE_OUT_CUBIC);
+
+    // Transient widgets are removed, their handles become stale
+    // (tooltips are above everything else)
+    const auto tooltip = ui.add<Panel>(Rect<float>{ 560.0f, 780.0f, 120.0f, 30.0f });
+    ui.setLayer(tooltip, UserInterface::e_layer::TOOLTIP);
+    ui.remove(tooltip);
+
+    if (!ui.get(tooltip))
+        cout << "Tooltip removed" << endl;
+
+    // A backend thread updates a widget: the UI thread applies it
+    std::thread worker([&ui, sound]()
+    {
+        ui.getDispatcher().post([&ui, sound]()
+        {
+            if (auto* checkbox = ui.get<Checkbox>(sound))
+                checkbox->setChecked(true);
+        });
+    });
+    worker.join();
 
 
     // Lets say we are running on a game loop
-    // Process system events
-    ui.processEvent({});
+    // Animations advance every frame (the panel is in place after 0.25 seconds)
+    for (int frame = 0; frame < 20; ++frame)
+        animator.update(1.0f / 60.0f);
+
+    // Process system events (the mouse hovers and clicks the button, then clicks the first checkbox)
+    SDL_Event event{};
+
+    // These two motion events are coalesced into one
+    event.motion = { SDL_MOUSEMOTION, 0, 590, 730, 0, 0 };
+    ui.processEvent(event);
+    event.motion = { SDL_MOUSEMOTION, 0, 600, 740, 10, 10 };
+    ui.processEvent(event);
+
+    event.button = { SDL_MOUSEBUTTONDOWN, 0, SDL_BUTTON_LEFT, 1, 600, 740 };
+    ui.processEvent(event);
+
+    event.button = { SDL_MOUSEBUTTONDOWN, 0, SDL_BUTTON_LEFT, 1, 310, 430 };
+    ui.processEvent(event);
+
+    event.button = { SDL_MOUSEBUTTONDOWN, 0, SDL_BUTTON_LEFT, 1, 80, 80 };
+    ui.processEvent(event);
+
+    // Scroll the list two steps down (the row under the mouse passes it to the list)
+    event.motion = { SDL_MOUSEMOTION, 0, 410, 60, 0, 0 };
+    ui.processEvent(event);
+    event.wheel = { SDL_MOUSEWHEEL, 0, 0, -2 };
+    ui.processEvent(event);
+
+    // Send them to the widgets
+    ui.dispatchEvents();
+
     // Render graphics
     ui.render();
 
+    // Nothing changed, so nothing is drawn
+    ui.render();
+
     return 0;
 }
+
+#endif